@@ -0,0 +1,176 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+#include "cpu_ray_marcher.hpp"
+#include "mapped_file.hpp"
+#include "raw_volume_ingest.hpp"
+#include "volume_file.hpp"
+
+namespace
+{
+    template <typename V> bool parse(std::string_view text, V& value)
+    {
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc() && end == text.data() + text.size();
+    }
+
+    // 二进制 PPM, 第 0 行在顶部, 因此从 target 的最后一行开始写
+    bool write_ppm(const std::filesystem::path& file, const pixel<uint32_t>& image)
+    {
+        std::ofstream f(file, std::ios::binary);
+        if (not f.is_open())
+            return false;
+        f << "P6\n" << image.size.x << " " << image.size.y << "\n255\n";
+        std::vector<char> row(static_cast<size_t>(image.size.x) * 3);
+        for (int y = image.size.y - 1; y >= 0; --y)
+        {
+            for (int x = 0; x < image.size.x; ++x)
+            {
+                uint32_t c = image(x, y);
+                row[x * 3 + 0] = static_cast<char>(c & 0xff);
+                row[x * 3 + 1] = static_cast<char>((c >> 8) & 0xff);
+                row[x * 3 + 2] = static_cast<char>((c >> 16) & 0xff);
+            }
+            f.write(row.data(), static_cast<std::streamsize>(row.size()));
+        }
+        return f.good();
+    }
+} // namespace
+
+// 无需 GPU 的命令行渲染 (渲染农场, 或与 GPU 结果逐像素对比), 不创建 OpenGL 上下文
+// 调用 cpu_ray_march<uint16_t> 会实例化 dispatch_table 中的全部 2 x 4 x 2 个内核
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        SPDLOG_ERROR("usage: <volume.mvv | volume.raw> <output.ppm> [--size X Y Z] [--u8] [--view W H] [--distance D] [--filter nearest|trilinear] "
+                     "[--composite mean|mip|drr|alpha] [--threshold A] [--skip] [--layout right|morton|tiled]");
+        return 1;
+    }
+    std::filesystem::path input = argv[1];
+    std::filesystem::path output = argv[2];
+    raw_volume_descriptor desc;
+    glm::ivec2 view_size{ 800, 600 };
+    float distance = 3.0f;
+    bool skip = false;
+    // 光线步进时体数据的内存布局, 三线性插值的 8 个角点经布局策略寻址
+    std::string_view layout = "right";
+    cpu_ray_march_options<uint16_t> options;
+    for (int i = 3; i < argc; ++i)
+    {
+        std::string_view arg = argv[i];
+        auto remaining = argc - i - 1;
+        bool ok = true;
+        if (arg == "--size" && remaining >= 3)
+        {
+            ok = parse(argv[i + 1], desc.size.x) && parse(argv[i + 2], desc.size.y) && parse(argv[i + 3], desc.size.z);
+            i += 3;
+        }
+        else if (arg == "--u8")
+        {
+            desc.type = raw_voxel_type::u8;
+            desc.normalization = { raw_normalization::mode::shift, 8 };
+        }
+        else if (arg == "--view" && remaining >= 2)
+        {
+            ok = parse(argv[i + 1], view_size.x) && parse(argv[i + 2], view_size.y);
+            i += 2;
+        }
+        else if (arg == "--distance" && remaining >= 1)
+            ok = parse(argv[++i], distance);
+        else if (arg == "--threshold" && remaining >= 1)
+            ok = parse(argv[++i], options.alpha_threshold);
+        else if (arg == "--filter" && remaining >= 1)
+        {
+            std::string_view name = argv[++i];
+            ok = name == "nearest" || name == "trilinear";
+            options.filter = name == "trilinear" ? sample_filter::trilinear : sample_filter::nearest;
+        }
+        else if (arg == "--composite" && remaining >= 1)
+        {
+            std::string_view name = argv[++i];
+            constexpr std::array<std::string_view, composite_mode_count> names = { "mean", "mip", "drr", "alpha" };
+            auto it = std::find(names.begin(), names.end(), name);
+            ok = it != names.end();
+            options.composite = static_cast<composite_mode>(it - names.begin());
+        }
+        else if (arg == "--skip")
+            skip = true;
+        else if (arg == "--layout" && remaining >= 1)
+        {
+            layout = argv[++i];
+            ok = layout == "right" || layout == "morton" || layout == "tiled";
+        }
+        else
+            ok = false;
+        if (not ok)
+        {
+            SPDLOG_ERROR("invalid argument: {}", arg);
+            return 1;
+        }
+    }
+
+    // 无需转换的 u16 raw 文件直接在映射上渲染, 其余情况读入 vol
+    voxel<uint16_t> vol;
+    mapped_voxel<uint16_t> mapped;
+    bool zero_copy = input.extension() != ".mvv" && desc.type == raw_voxel_type::u16 && desc.normalization.type == raw_normalization::mode::none &&
+                     desc.endian == std::endian::native && desc.slice_order == raw_slice_order::z_ascending;
+    if (zero_copy)
+    {
+        auto mapped_ret = map_raw_volume<uint16_t>(input, desc.size, desc.header_offset);
+        if (not mapped_ret.has_value())
+        {
+            SPDLOG_ERROR("map volume failed: {}", mapped_ret.error());
+            return 1;
+        }
+        mapped = std::move(mapped_ret.value());
+    }
+    else
+    {
+        auto vol_ret = input.extension() == ".mvv" ? load_volume_file<uint16_t>(input) : ingest_raw_volume<uint16_t>(input, desc);
+        if (not vol_ret.has_value())
+        {
+            SPDLOG_ERROR("load volume failed: {}", vol_ret.error());
+            return 1;
+        }
+        vol = std::move(vol_ret.value());
+    }
+    volume_view<const uint16_t> view = mapped.file ? mapped.view : as_view(vol);
+
+    macro_cell_grid<uint16_t> cells;
+    if (skip)
+    {
+        cells = build_macro_cell_grid<uint16_t>(view, 8);
+        options.cells = &cells;
+    }
+
+    camera_info cam;
+    cam.aspect_ratio = static_cast<float>(view_size.x) / static_cast<float>(view_size.y);
+    cam.position = glm::vec3(0.0f, 0.0f, distance);
+    cam.target_distance = distance;
+
+    auto target = make_pixel<uint32_t>(view_size);
+    // 转换布局不计入耗时
+    auto march = [&](const auto& volume) {
+        auto start = std::chrono::steady_clock::now();
+        cpu_ray_march(cam, volume, target, options);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    double seconds = layout == "morton" ? march(relayout<layout_morton>(view)) : layout == "tiled" ? march(relayout<layout_tiled<8, 8, 8>>(view)) : march(view);
+    SPDLOG_INFO("cpu ray march {}x{} ({} layout): {:.1f} ms", view_size.x, view_size.y, layout, seconds * 1000.0);
+
+    if (not write_ppm(output, target))
+    {
+        SPDLOG_ERROR("write image failed: {}", output.string());
+        return 1;
+    }
+    return 0;
+}
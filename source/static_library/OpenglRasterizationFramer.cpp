@@ -14,11 +14,30 @@
 #include <imgui.h>
 #include <implot.h>
 
+#include "ambient_occlusion.hpp"
+#include "axis_projection.hpp"
+#include "cpu_ray_marcher.hpp"
 #include "interface/pixel.hpp"
 #include "interface/voxel.hpp"
+#include "macro_cell_grid.hpp"
+#include "marching_cubes.hpp"
+#include "material_brick_index.hpp"
+#include "material_classify.hpp"
+#include "mip_pyramid.hpp"
+#include "morphology.hpp"
+#include "mpr.hpp"
+#include "summed_volume_table.hpp"
 #include "texture_from.hpp"
+#include "volume_filter.hpp"
+#include "volume_statistics.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
 #include <set>
+#include <vector>
 
 using texture_t = uint32_t;
 using shader_t = uint32_t;
@@ -30,6 +49,11 @@ static texture_t color_table_tex = 0;
 static texture_t vol_le_tex = 0;
 static texture_t vol_he_tex = 0;
 static texture_t vol_tex = 0;
+static texture_t macro_cell_tex = 0;
+static texture_t vol_label_tex = 0;
+static texture_t material_brick_tex = 0;
+static texture_t gradient_tex = 0;
+static texture_t occlusion_tex = 0;
 
 static pixel<uint32_t> color_table = make_pixel<uint32_t>({ 256, 256 });
 // Equivalent thickness and equivalent atomic number
@@ -37,6 +61,69 @@ static pixel<uint32_t> color_table = make_pixel<uint32_t>({ 256, 256 });
 static voxel<uint16_t> vol_le = make_voxel<uint16_t>({ 64, 64, 64 });
 static voxel<uint16_t> vol_he = make_voxel<uint16_t>({ 64, 64, 64 });
 static voxel<uint16_t> vol = make_voxel<uint16_t>({ 64, 64, 64 });
+// 加载 vol_le / vol_he 后, 上传纹理前执行的预处理, 由 Denoise 窗口每次应用的滤波追加, 重新加载时按顺序重放
+static filter_pipeline load_filters;
+static std::vector<filter_timing> filter_timings;
+// vol_le / vol_he 每次被替换后加 1, 依赖它们的 CPU 视图据此判断是否需要刷新
+static int volume_revision = 0;
+// 由 color_table 对 (vol_le, vol_he) 分类得到的材料标签, material_palette[label] 为颜色
+static voxel<uint8_t> vol_label;
+static std::vector<uint32_t> material_palette;
+// vol_label 的分块材料索引, 只显示所选材料时跳过不含这些材料的砖块
+static material_brick_index vol_label_bricks;
+static material_set material_selection;
+static size_t selected_brick_count = 0; // 含所选材料的砖块数, 选择或数据改变时更新
+static bool material_filter = false;
+// 加载时统计的直方图, 用于传输函数和窗宽窗位
+static dual_energy_statistics vol_stats;
+// ROI 读数用的积分体, 勾选后才构建
+static summed_volume_table<uint16_t> vol_le_table;
+static summed_volume_table<uint16_t> vol_he_table;
+// vol_le 的宏单元网格, 光线步进时跳过空单元
+static macro_cell_grid<uint16_t> vol_le_cells;
+static bool skip_empty_cells = true;
+// vol_le_tex 带有平均值 mip 链, 光线步进读取该级别, 步长随级别加倍
+static int volume_lod = 0;
+// vol_le 的梯度体, 着色时每个采样点只多一次纹理读取; 第一次开启着色时才构建
+static gradient_volume vol_le_gradient;
+static bool shading = false;
+// 按当前传输函数 (alpha_threshold) 烘焙的 vol_le 环境光遮蔽, 阈值变化时增量更新
+// 拖动阈值期间不烘焙, 阈值保持 occlusion_debounce 不变后才更新, 此前沿用上一次的结果
+static occlusion_cache vol_le_occlusion;
+static bool ambient_occlusion = false;
+static float occlusion_threshold = -1.0f;
+static float occlusion_pending_threshold = -1.0f;
+static std::chrono::steady_clock::time_point occlusion_pending_since;
+constexpr auto occlusion_debounce = std::chrono::milliseconds(300);
+static float alpha_threshold = 0.01f;
+
+// 渲染模式: 0 光线步进, 1 轴向投影 (CPU), 2 等值面网格
+static int render_mode = 0;
+static int projection_source = 0; // 0: vol_le, 1: vol_he
+static int projection_axis = 2;
+static int projection_op = 0; // 对应 projection_reduction
+static texture_t projection_tex = 0;
+static glm::ivec2 projection_size{ 0 };
+
+// 按当前相机用 CPU 光线步进重新渲染一帧, 与 GPU 结果逐像素比较
+static bool cpu_reference_requested = false;
+static texture_t cpu_reference_tex = 0;
+static double cpu_reference_ms = 0.0;
+static int cpu_reference_max_diff = 0;
+static double cpu_reference_mean_diff = 0.0;
+
+// 等值面网格: 0 为 vol_le 在 alpha_threshold 处的等值面, 1 为所选材料的表面
+static int mesh_source = 0;
+static program_t mesh_program = 0;
+static uint32_t mesh_vertex_array_object = 0;
+static uint32_t mesh_vertex_buffer = 0;
+static uint32_t mesh_element_buffer = 0;
+static size_t mesh_vertex_count = 0;
+static size_t mesh_index_count = 0;
+
+// CPU 多平面重建: 三个正交切面 + 一个斜切面
+static std::array<texture_t, 4> mpr_tex{};
+static std::array<glm::ivec2, 4> mpr_size{};
 
 static uint16_t view_width = 800;
 static uint16_t view_height = 600;
@@ -44,6 +131,7 @@ static texture_t render_texture = 0;
 static program_t user_program = 0;
 static uint32_t user_framebuffer_id = 0;
 static uint32_t user_vertex_array_object = 0;
+static uint32_t user_depth_buffer = 0;
 
 static inline bool check_compile_errors(shader_t shader, std::source_location loc = std::source_location::current())
 {
@@ -161,11 +249,60 @@ static inline GLuint render_3d_texture_preview(GLuint tex3d, int axis, float sli
 }
 
 #include "camera_info.hpp"
+#include "connected_components.hpp"
+#include "gradient_volume.hpp"
 
-#include "load_raw_file.hpp"
+#include "mapped_file.hpp"
 
 #include "img.h"
 
+// 由 vol_le / vol_he 重建纹理, 宏单元, 材料标签和统计, 已有的纹理对象会被复用
+static inline void update_dual_energy()
+{
+    vol_le_tex = texture_from(build_mip_pyramid<uint16_t>(as_view(vol_le)), vol_le_tex);
+    vol_he_tex = texture_from(vol_he, vol_he_tex);
+
+    vol_le_cells = build_macro_cell_grid<uint16_t>(vol_le, 8);
+    macro_cell_tex = texture_from(vol_le_cells.cells, macro_cell_tex);
+
+    vol_label = classify_materials(vol_le, vol_he, make_material_lut(color_table, material_palette));
+    vol_label_tex = texture_from(vol_label, vol_label_tex);
+    vol_label_bricks = build_material_brick_index(vol_label);
+    material_selection = vol_label_bricks.present;
+    material_brick_tex = texture_from(vol_label_bricks.selection(material_selection), material_brick_tex);
+    selected_brick_count = vol_label_bricks.count_bricks_with(material_selection);
+
+    vol_stats = compute_dual_energy_statistics(vol_le, vol_he);
+    vol_le_table = {};
+    vol_he_table = {};
+    vol_le_gradient = {};
+    vol_le_occlusion = {};
+    occlusion_threshold = -1.0f;
+    ++volume_revision;
+}
+
+// 读取原始双能数据到 vol_le / vol_he 并执行 load_filters, 不更新纹理
+static inline bool load_dual_energy()
+{
+    auto original_volumes_ret = get_original_volume("CT", nullptr);
+    if (not original_volumes_ret.has_value())
+    {
+        SPDLOG_ERROR("load volume failed: {}", original_volumes_ret.error());
+        return false;
+    }
+    auto& original_vol = original_volumes_ret.value();
+    vol_le = make_voxel<uint16_t>({ original_vol->miu.width, original_vol->miu.height, original_vol->miu.slices }, original_vol->miu.data);
+    vol_he = make_voxel<uint16_t>({ original_vol->zeff.width, original_vol->zeff.height, original_vol->zeff.slices }, original_vol->zeff.data);
+
+    filter_timings.clear();
+    if (not load_filters.empty())
+    {
+        vol_le = load_filters.run(std::move(vol_le), &filter_timings);
+        vol_he = load_filters.run(std::move(vol_he), &filter_timings);
+    }
+    return true;
+}
+
 void init()
 {
     global::onlyone::create<texture_pool>();
@@ -188,41 +325,263 @@ void init()
     auto& color = color_ret.value();
     color_table = make_pixel<uint32_t>({ color.width, color.height }, std::span<uint32_t>((uint32_t*)color.table.data(), color.table.size() / 4));
 
-    auto original_volumes_ret = get_original_volume("CT", nullptr);
-    if (not original_volumes_ret.has_value())
-    {
-        SPDLOG_ERROR("load volume failed: {}", original_volumes_ret.error());
+    if (not load_dual_energy())
         return;
-    }
-    auto& original_vol = original_volumes_ret.value();
-    vol_le = make_voxel<uint16_t>({ original_vol->miu.width, original_vol->miu.height, original_vol->miu.slices }, original_vol->miu.data);
-    vol_he = make_voxel<uint16_t>({ original_vol->zeff.width, original_vol->zeff.height, original_vol->zeff.slices }, original_vol->zeff.data);
 #endif
 
-    auto buffer = load_raw_file("foot.raw");
-    std::vector<uint16_t> buffer16(buffer.size());
-    for (size_t i = 0; i < buffer.size(); ++i)
-        buffer16[i] = static_cast<uint16_t>(buffer[i]) << 8;
-    vol = make_voxel<uint16_t>({ 256, 256, 256 }, buffer16);
-
     color_table_tex = texture_from(color_table);
-    vol_le_tex = texture_from(vol_le);
-    vol_he_tex = texture_from(vol_he);
-    vol_tex = texture_from(vol);
+    // foot.raw 为 u8, 预览着色器按 0 ~ 255 显示, 不需要转换: 映射文件后直接上传为 R8UI 纹理, 不经过堆上的拷贝
+    // 读取失败时上传占位的 vol, 其余纹理和派生数据照常建立
+    auto foot_ret = map_raw_volume<uint8_t>("foot.raw", { 256, 256, 256 });
+    if (foot_ret.has_value())
+        vol_tex = texture_from(foot_ret.value().view);
+    else
+    {
+        SPDLOG_ERROR("load volume failed: {}", foot_ret.error());
+        vol_tex = texture_from(vol);
+    }
+
+    update_dual_energy();
 
     global::onlyone::call<texture_pool>([&](texture_pool& pool) {
         pool.insert(vol_le_tex);
         pool.insert(vol_he_tex);
         pool.insert(vol_tex);
+        pool.insert(vol_label_tex);
         return true;
     });
 }
+// 投影结果按最大值归一化为灰度图
+static inline pixel<uint32_t> gray_from(const pixel<float>& img)
+{
+    float hi = 0.0f;
+    for (float v : img.memory)
+        hi = std::max(hi, v);
+    pixel<uint32_t> gray = make_pixel<uint32_t>(img.size);
+    float scale = hi > 0.0f ? 255.0f / hi : 0.0f;
+    for (size_t i = 0; i < img.memory.size(); ++i)
+    {
+        auto c = static_cast<uint32_t>(img.memory[i] * scale + 0.5f);
+        gray.memory[i] = 0xff000000u | (c << 16) | (c << 8) | c;
+    }
+    return gray;
+}
+static inline void update_projection()
+{
+    const auto& source = projection_source == 0 ? vol_le : vol_he;
+    auto img = project_axis<float>(source, projection_axis, static_cast<projection_reduction>(projection_op));
+    projection_size = img.size;
+    projection_tex = texture_from(gray_from(img), projection_tex);
+}
+
+// 在光线步进的帧缓冲仍绑定时调用; 梯度着色, 环境光遮蔽和材料过滤只在着色器中实现, 比较前应关闭
+static inline void compare_cpu_reference(const camera_info& cam)
+{
+    cpu_reference_requested = false;
+    auto gpu = make_pixel<uint32_t>({ view_width, view_height });
+    glReadPixels(0, 0, view_width, view_height, GL_RGBA, GL_UNSIGNED_BYTE, gpu.memory.data());
+
+    cpu_ray_march_options<uint16_t> options;
+    options.alpha_threshold = alpha_threshold;
+    options.cells = skip_empty_cells ? &vol_le_cells : nullptr;
+    auto cpu = make_pixel<uint32_t>(gpu.size);
+    auto start = std::chrono::steady_clock::now();
+    cpu_ray_march(cam, vol_le, cpu, options);
+    cpu_reference_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    int max_diff = 0;
+    uint64_t sum = 0;
+    for (size_t i = 0; i < gpu.memory.size(); ++i)
+    {
+        int diff = std::abs(static_cast<int>(gpu.memory[i] & 0xff) - static_cast<int>(cpu.memory[i] & 0xff));
+        max_diff = std::max(max_diff, diff);
+        sum += diff;
+    }
+    cpu_reference_max_diff = max_diff;
+    cpu_reference_mean_diff = static_cast<double>(sum) / static_cast<double>(std::max<size_t>(gpu.memory.size(), 1));
+    cpu_reference_tex = texture_from(cpu, cpu_reference_tex);
+}
+
+static inline void update_mesh()
+{
+    auto mesh = mesh_source == 0 ? extract_isosurface(vol_le, alpha_threshold * 256.0f) : extract_material_surface(vol_label, material_selection);
+    glBindVertexArray(mesh_vertex_array_object);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(mesh_vertex), mesh.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_element_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    mesh_vertex_count = mesh.vertices.size();
+    mesh_index_count = mesh.indices.size();
+    SPDLOG_INFO("isosurface: {} vertices, {} triangles", mesh_vertex_count, mesh_index_count / 3);
+}
+
+static inline void show_histogram(const char* label, const volume_histogram<uint16_t>& hist)
+{
+    auto window = hist.window();
+    ImGui::Text("%s: min %u max %u mean %.2f stddev %.2f window [%u, %u]", label, unsigned(hist.min), unsigned(hist.max), hist.mean, hist.stddev, unsigned(window.x),
+                unsigned(window.y));
+    // 只显示有数据的范围, 合并为 256 个区间
+    size_t last = std::max<size_t>(hist.max, 255) + 1;
+    size_t width = (last + 255) / 256;
+    std::vector<double> bins((last + width - 1) / width, 0.0);
+    for (size_t v = 0; v < last; ++v)
+        bins[v / width] += static_cast<double>(hist.counts[v]);
+    ImPlot::PlotStairs(label, bins.data(), static_cast<int>(bins.size()), static_cast<double>(width));
+}
+
+static inline void update_mpr(glm::vec3 center, float yaw, float pitch, float thickness, int mode)
+{
+    glm::ivec3 size = vol_le.size;
+    glm::vec3 slice = center * glm::vec3(size - 1);
+    std::array<mpr_plane, 4> planes;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        planes[axis] = make_axis_plane(size, axis, center[axis]);
+        planes[axis].thickness = thickness;
+        planes[axis].mode = static_cast<slab_mode>(mode);
+    }
+    glm::vec3 normal = { std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw) };
+    int extent = std::max(std::max(size.x, size.y), size.z);
+    planes[3] = make_oblique_plane(slice, normal, { extent, extent });
+    planes[3].thickness = thickness;
+    planes[3].mode = static_cast<slab_mode>(mode);
+
+    auto images = reslice<float>(vol_le, std::span<const mpr_plane>(planes));
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        mpr_size[i] = images[i].size;
+        mpr_tex[i] = texture_from(gray_from(images[i]), mpr_tex[i]);
+    }
+}
+
 void update()
 {
     // ImGui::SetNextWindowSize(ImVec2(820, 620), ImGuiCond_Once);
     ImGui::Begin("Preview", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
-    if (render_texture != 0)
+    ImGui::Checkbox("Empty Space Skipping", &skip_empty_cells);
+    ImGui::SliderFloat("Alpha Threshold", &alpha_threshold, 0.0f, 1.0f);
+    ImGui::SliderInt("Volume LOD", &volume_lod, 0, 4);
+    ImGui::Checkbox("Gradient Shading", &shading);
+    if (shading && vol_le_gradient.packed.memory.empty())
+    {
+        vol_le_gradient = build_gradient_volume(vol_le);
+        gradient_tex = texture_from(vol_le_gradient.packed, gradient_tex);
+    }
+    ImGui::Checkbox("Ambient Occlusion", &ambient_occlusion);
+    if (ambient_occlusion && occlusion_threshold != alpha_threshold)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (occlusion_pending_threshold != alpha_threshold)
+        {
+            occlusion_pending_threshold = alpha_threshold;
+            occlusion_pending_since = now;
+        }
+        // 还没有烘焙过 (刚开启或重新加载) 时立即烘焙
+        if (vol_le_occlusion.transfer.empty() || now - occlusion_pending_since >= occlusion_debounce)
+        {
+            occlusion_threshold = alpha_threshold;
+            if (update_occlusion_cache(vol_le_occlusion, vol_le, make_threshold_opacity(alpha_threshold)))
+                occlusion_tex = texture_from(vol_le_occlusion.occlusion, occlusion_tex);
+        }
+    }
+    ImGui::Combo("Render Mode", &render_mode, "Ray March\0Axis Projection\0Isosurface\0");
+    ImGui::Checkbox("Material Filter", &material_filter);
+    if (material_filter)
+    {
+        bool selection_changed = false;
+        for (size_t label = 0; label < material_palette.size(); ++label)
+        {
+            if (not vol_label_bricks.present[label])
+                continue;
+            uint32_t c = material_palette[label];
+            ImGui::PushID(static_cast<int>(label));
+            ImGui::ColorButton("##color", ImVec4((c & 0xff) / 255.0f, ((c >> 8) & 0xff) / 255.0f, ((c >> 16) & 0xff) / 255.0f, 1.0f), ImGuiColorEditFlags_NoTooltip);
+            ImGui::SameLine();
+            bool selected = material_selection[label];
+            if (ImGui::Checkbox(fmt::format("Material {}", label).c_str(), &selected))
+            {
+                material_selection[label] = selected;
+                selection_changed = true;
+            }
+            ImGui::PopID();
+        }
+        if (selection_changed)
+        {
+            material_brick_tex = texture_from(vol_label_bricks.selection(material_selection), material_brick_tex);
+            selected_brick_count = vol_label_bricks.count_bricks_with(material_selection);
+        }
+        ImGui::Text("bricks: %zu / %zu", selected_brick_count, vol_label_bricks.brick_count());
+
+        // 所选材料的连通区域, 按体素数列出最大的几个
+        static int component_connectivity = 2;
+        static std::vector<component_info> largest_components;
+        static size_t component_count = 0;
+        ImGui::Combo("Connectivity", &component_connectivity, "6\0" "18\0" "26\0");
+        if (ImGui::Button("Label Components"))
+        {
+            constexpr std::array<connectivity, 3> modes = { connectivity::face, connectivity::edge, connectivity::vertex };
+            auto regions = label_connected_components(vol_label, material_selection, modes[component_connectivity], vol_le, vol_he);
+            component_count = regions.components.size();
+            largest_components = std::move(regions.components);
+            size_t keep = std::min<size_t>(largest_components.size(), 8);
+            std::partial_sort(largest_components.begin(), largest_components.begin() + keep, largest_components.end(),
+                              [](const component_info& a, const component_info& b) { return a.voxel_count > b.voxel_count; });
+            largest_components.resize(keep);
+        }
+        ImGui::Text("components: %zu", component_count);
+        for (const auto& info : largest_components)
+            ImGui::Text("%llu voxels, [%d %d %d] - [%d %d %d], miu %.2f, Zeff %.2f", static_cast<unsigned long long>(info.voxel_count), info.min.x, info.min.y, info.min.z,
+                        info.max.x, info.max.y, info.max.z, info.mean_le, info.mean_he);
+
+        static int morphology_radius = 2;
+        static std::vector<morphology_throughput> morphology_results;
+        ImGui::SliderInt("Morphology Radius", &morphology_radius, 1, 16);
+        if (ImGui::Button("Benchmark Morphology"))
+            morphology_results = benchmark_morphology(vol_label, glm::ivec3(morphology_radius));
+        for (const auto& result : morphology_results)
+            ImGui::Text("%s: %.2f ms, %.1f Mvoxel/s", result.name.c_str(), result.seconds * 1000.0, result.voxels_per_second / 1e6);
+    }
+    if (render_mode == 2)
+    {
+        static int mesh_revision = -1;
+        bool changed = mesh_revision != volume_revision;
+        mesh_revision = volume_revision;
+        changed |= ImGui::Combo("Surface", &mesh_source, "Low Energy Threshold\0Selected Materials\0");
+        changed |= ImGui::Button("Extract Surface");
+        if (changed)
+            update_mesh();
+        ImGui::Text("vertices: %zu, triangles: %zu", mesh_vertex_count, mesh_index_count / 3);
+    }
+    if (render_mode == 1)
+    {
+        static int projection_revision = -1;
+        bool changed = projection_tex == 0 || projection_revision != volume_revision;
+        projection_revision = volume_revision;
+        changed |= ImGui::Combo("Source", &projection_source, "Low Energy\0High Energy\0");
+        changed |= ImGui::Combo("Axis", &projection_axis, "X\0Y\0Z\0");
+        changed |= ImGui::Combo("Reduction", &projection_op, "MIP\0MinIP\0Average\0Sum\0");
+        if (changed)
+            update_projection();
+        if (projection_tex != 0 && projection_size.y > 0)
+        {
+            float scale = static_cast<float>(view_height) / static_cast<float>(projection_size.y);
+            ImGui::Image((ImTextureID)(intptr_t)projection_tex, ImVec2(projection_size.x * scale, view_height), ImVec2(0, 1), ImVec2(1, 0));
+        }
+    }
+    else if (render_texture != 0)
         ImGui::Image((ImTextureID)(intptr_t)render_texture, ImVec2(view_width, view_height), ImVec2(0, 1), ImVec2(1, 0));
+    if (render_mode == 0)
+    {
+        // CPU 光线步进始终读取原始分辨率, 只在 LOD 0 时可比
+        if (volume_lod == 0 && ImGui::Button("Compare with CPU"))
+            cpu_reference_requested = true;
+        if (cpu_reference_tex != 0)
+        {
+            ImGui::Text("cpu: %.1f ms, max diff %d, mean diff %.3f", cpu_reference_ms, cpu_reference_max_diff, cpu_reference_mean_diff);
+            ImGui::Image((ImTextureID)(intptr_t)cpu_reference_tex, ImVec2(view_width * 0.5f, view_height * 0.5f), ImVec2(0, 1), ImVec2(1, 0));
+        }
+    }
     ImGui::End();
     static texture_t selected_preview_tex = 0;
     bool force_update = false;
@@ -254,6 +613,124 @@ void update()
         ImGui::Image((ImTextureID)(intptr_t)preview_tex, ImVec2(640, 640), ImVec2(0, 1), ImVec2(1, 0));
     }
     ImGui::End();
+
+    ImGui::Begin("CPU MPR");
+    static glm::vec3 mpr_center = glm::vec3(0.5f);
+    static float mpr_yaw = 0.0f;
+    static float mpr_pitch = 0.0f;
+    static float mpr_thickness = 0.0f;
+    static int mpr_mode = 0;
+    static int mpr_revision = -1;
+    bool mpr_changed = mpr_tex[0] == 0 || mpr_revision != volume_revision;
+    mpr_revision = volume_revision;
+    mpr_changed |= ImGui::SliderFloat3("Center", &mpr_center.x, 0.0f, 1.0f);
+    mpr_changed |= ImGui::SliderAngle("Yaw", &mpr_yaw, -180.0f, 180.0f);
+    mpr_changed |= ImGui::SliderAngle("Pitch", &mpr_pitch, -90.0f, 90.0f);
+    mpr_changed |= ImGui::SliderFloat("Thickness", &mpr_thickness, 0.0f, 32.0f);
+    mpr_changed |= ImGui::Combo("Slab", &mpr_mode, "MIP\0Average\0");
+    if (mpr_changed)
+        update_mpr(mpr_center, mpr_yaw, mpr_pitch, mpr_thickness, mpr_mode);
+    for (size_t i = 0; i < mpr_tex.size(); ++i)
+    {
+        if (mpr_tex[i] == 0 || mpr_size[i].y <= 0)
+            continue;
+        float scale = 240.0f / static_cast<float>(std::max(mpr_size[i].x, mpr_size[i].y));
+        if (i % 2 == 1)
+            ImGui::SameLine();
+        ImGui::Image((ImTextureID)(intptr_t)mpr_tex[i], ImVec2(mpr_size[i].x * scale, mpr_size[i].y * scale), ImVec2(0, 1), ImVec2(1, 0));
+    }
+    ImGui::End();
+
+    ImGui::Begin("Denoise");
+    static int filter_kind = 0;
+    static float gaussian_sigma = 1.0f;
+    static float bilateral_spatial = 1.0f;
+    static float bilateral_range = 8.0f;
+    static int bilateral_radius = 1;
+    ImGui::Combo("Filter", &filter_kind, "Gaussian\0Median 3x3x3\0Bilateral\0");
+    if (filter_kind == 0)
+        ImGui::SliderFloat("Sigma", &gaussian_sigma, 0.3f, 4.0f);
+    else if (filter_kind == 2)
+    {
+        ImGui::SliderFloat("Spatial Sigma", &bilateral_spatial, 0.3f, 4.0f);
+        ImGui::SliderFloat("Range Sigma", &bilateral_range, 1.0f, 256.0f);
+        ImGui::SliderInt("Radius", &bilateral_radius, 1, 3);
+    }
+    if (ImGui::Button("Apply To LE/HE"))
+    {
+        // 在当前数据上追加一级, 同一级也追加到 load_filters, 重新加载时重放整条处理链
+        filter_pipeline pipeline;
+        if (filter_kind == 0)
+            pipeline.gaussian(glm::vec3(gaussian_sigma));
+        else if (filter_kind == 1)
+            pipeline.median();
+        else
+            pipeline.bilateral(bilateral_spatial, bilateral_range, bilateral_radius);
+        vol_le = pipeline.run(std::move(vol_le), &filter_timings);
+        vol_he = pipeline.run(std::move(vol_he), &filter_timings);
+        load_filters.stages.insert(load_filters.stages.end(), pipeline.stages.begin(), pipeline.stages.end());
+        update_dual_energy();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reload"))
+    {
+        if (load_dual_energy())
+            update_dual_energy();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear Chain"))
+        load_filters.stages.clear();
+    std::string chain;
+    for (const auto& [name, stage] : load_filters.stages)
+        chain += chain.empty() ? name : " -> " + name;
+    ImGui::Text("load chain: %s", chain.empty() ? "(none)" : chain.c_str());
+    for (const auto& timing : filter_timings)
+        ImGui::Text("%s: %.2f ms", timing.name.c_str(), timing.seconds * 1000.0);
+    ImGui::End();
+
+    ImGui::Begin("Statistics");
+    ImGui::Text("voxels: %llu", static_cast<unsigned long long>(vol_stats.le.total));
+    if (ImPlot::BeginPlot("Histogram", ImVec2(480, 240)))
+    {
+        ImPlot::SetupAxisScale(ImAxis_Y1, ImPlotScale_Log10);
+        show_histogram("Low Energy", vol_stats.le);
+        show_histogram("High Energy", vol_stats.he);
+        ImPlot::EndPlot();
+    }
+    if (not vol_stats.joint.counts.empty() && ImPlot::BeginPlot("Joint Histogram (miu / Zeff)", ImVec2(480, 480)))
+    {
+        // 对数刻度, 否则背景体素会淹没其余所有区间; 行按高能值从上到下排列
+        const auto& joint = vol_stats.joint;
+        static std::vector<float> heat;
+        heat.resize(joint.counts.size());
+        for (int y = 0; y < joint.size.y; ++y)
+            for (int x = 0; x < joint.size.x; ++x)
+                heat[static_cast<size_t>(joint.size.y - 1 - y) * joint.size.x + x] = std::log10(1.0f + static_cast<float>(joint(x, y)));
+        float scale_max = *std::max_element(heat.begin(), heat.end());
+        ImPlot::PlotHeatmap("joint", heat.data(), joint.size.y, joint.size.x, 0.0, std::max(scale_max, 1.0f), nullptr, ImPlotPoint(0, 0),
+                            ImPlotPoint(joint.value_max.x + 1.0, joint.value_max.y + 1.0));
+        ImPlot::EndPlot();
+    }
+
+    static bool roi_tables = false;
+    static volume_roi roi;
+    ImGui::Checkbox("ROI Summed-Volume Tables", &roi_tables);
+    if (roi_tables && vol_le_table.size != vol_le.size)
+    {
+        vol_le_table = build_summed_volume_table(vol_le);
+        vol_he_table = build_summed_volume_table(vol_he);
+        roi = { glm::ivec3(0), vol_le.size };
+    }
+    if (roi_tables)
+    {
+        ImGui::SliderInt3("ROI Begin", &roi.begin.x, 0, std::max(std::max(vol_le.size.x, vol_le.size.y), vol_le.size.z));
+        ImGui::SliderInt3("ROI End", &roi.end.x, 0, std::max(std::max(vol_le.size.x, vol_le.size.y), vol_le.size.z));
+        ImGui::Text("voxels: %zu", vol_le_table.box_count(roi));
+        ImGui::Text("miu: mean %.3f stddev %.3f sum %llu", vol_le_table.mean(roi), std::sqrt(vol_le_table.variance(roi)),
+                    static_cast<unsigned long long>(vol_le_table.box_sum(roi)));
+        ImGui::Text("Zeff: mean %.3f stddev %.3f", vol_he_table.mean(roi), std::sqrt(vol_he_table.variance(roi)));
+    }
+    ImGui::End();
 }
 void uninit() {}
 
@@ -284,6 +761,19 @@ int OpenglRasterizationFramer::initialize()
     glEnableVertexAttribArray(1);
     user_vertex_array_object = vertex_array_object;
 
+    // 等值面网格, 顶点为 mesh_vertex: 位置 + 八面体编码的法线, 数据在提取时上传
+    glGenVertexArrays(1, &mesh_vertex_array_object);
+    glGenBuffers(1, &mesh_vertex_buffer);
+    glGenBuffers(1, &mesh_element_buffer);
+    glBindVertexArray(mesh_vertex_array_object);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh_vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh_element_buffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(mesh_vertex), (void*)offsetof(mesh_vertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(mesh_vertex), (void*)offsetof(mesh_vertex, normal));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
     const char* vertex_shader_source = R"(
         #version 330 core
         layout (location = 0) in vec3 position;
@@ -304,8 +794,23 @@ int OpenglRasterizationFramer::initialize()
     )";
     const char* fragment_shader_source = R"(
         #version 410 core
-        uniform usampler3D volume1_tex;
+        uniform usampler3D volume1_tex; // 平均值 mip 链, 最近邻过滤
+        uniform int volume_lod;
+        uniform usampler3D macro_cell_tex; // rg: 单元内最小值, 最大值
+        uniform int macro_cell_size;
+        uniform bool skip_empty;
+        uniform float alpha_threshold;
         uniform vec3 camera_position;
+        uniform bool material_filter;
+        uniform usampler3D label_tex;
+        uniform usampler3D material_brick_tex; // r: 砖块内含有所选材料
+        uniform int material_brick_size;
+        uniform uint material_selection[8]; // 256 位, 第 i 位对应标签 i
+        uniform bool shading;
+        uniform sampler3D gradient_tex; // xyz: 梯度向量, w: 梯度模长, 均已按最大模长归一化, 线性过滤
+        uniform bool ambient_occlusion;
+        uniform sampler3D occlusion_tex; // r: 低分辨率遮蔽体, 1 为不被遮挡
+        uniform vec3 occlusion_scale;    // 体数据纹理坐标到遮蔽体纹理坐标的缩放, 见 occlusion_cache::texture_scale
 
         in vec2 ver_TexCoord;
         in vec3 ver_FragPos;
@@ -318,6 +823,16 @@ int OpenglRasterizationFramer::initialize()
             int count;
         };
 
+        // 跳到单元出口之后的第一个采样点, 被跳过的采样点都在该单元内
+        int skip_cell(int i, ivec3 cell, int cell_size, ivec3 volume_size, vec3 origin, vec3 inv_direction, float step_size)
+        {
+            vec3 cell_lo = vec3(cell * cell_size) / vec3(volume_size) - vec3(0.5);
+            vec3 cell_hi = vec3((cell + 1) * cell_size) / vec3(volume_size) - vec3(0.5);
+            vec3 t_far = max((cell_lo - origin) * inv_direction, (cell_hi - origin) * inv_direction);
+            float t_exit = min(min(t_far.x, t_far.y), t_far.z);
+            return max(i, int(ceil(t_exit / step_size)) - 1);
+        }
+
         void main()
         {
             if (gl_FrontFacing == false)
@@ -328,17 +843,64 @@ int OpenglRasterizationFramer::initialize()
             r.position = ver_FragPos;
             r.value = 0.0;
             r.count = 0;
+
+            ivec3 volume_size = textureSize(volume1_tex, 0);
+            ivec3 cell_count = textureSize(macro_cell_tex, 0);
+            ivec3 brick_count = textureSize(material_brick_tex, 0);
+            vec3 safe_direction = mix(r.direction, vec3(1e-8), lessThan(abs(r.direction), vec3(1e-8)));
+            vec3 inv_direction = 1.0 / safe_direction;
+            // 粗级别的体素边长为 2^lod 个原始体素, 采样间隔同步放大
+            float step_size = 0.005 * exp2(float(volume_lod));
             for (int i = 0; i < 10000; i++)
             {
-                vec3 coord = r.position + r.direction * float(i) * 0.005;
+                vec3 coord = r.position + r.direction * float(i) * step_size;
                 if (any(lessThan(coord, vec3(-0.5))) || any(greaterThan(coord, vec3(0.5))))
                     break;
                 vec3 tex_coord = coord + vec3(0.5);
-                uint intensity = texture(volume1_tex, tex_coord).r;
+
+                if (skip_empty)
+                {
+                    ivec3 cell = clamp(ivec3(tex_coord * vec3(volume_size)) / macro_cell_size, ivec3(0), cell_count - 1);
+                    uint cell_max = texelFetch(macro_cell_tex, cell, 0).g;
+                    if (float(cell_max) / 256.0 < alpha_threshold)
+                    {
+                        // 被跳过的采样点都在空单元内, 结果与逐点步进一致
+                        i = skip_cell(i, cell, macro_cell_size, volume_size, r.position, inv_direction, step_size);
+                        continue;
+                    }
+                }
+
+                if (material_filter)
+                {
+                    ivec3 voxel_coord = clamp(ivec3(tex_coord * vec3(volume_size)), ivec3(0), volume_size - 1);
+                    ivec3 brick = clamp(voxel_coord / material_brick_size, ivec3(0), brick_count - 1);
+                    if (texelFetch(material_brick_tex, brick, 0).r == 0u)
+                    {
+                        i = skip_cell(i, brick, material_brick_size, volume_size, r.position, inv_direction, step_size);
+                        continue;
+                    }
+                    uint label = texelFetch(label_tex, voxel_coord, 0).r;
+                    if ((material_selection[label >> 5] & (1u << (label & 31u))) == 0u)
+                        continue;
+                }
+
+                uint intensity = textureLod(volume1_tex, tex_coord, float(volume_lod)).r;
                 float alpha = float(intensity) / 256.0;
-                if (alpha < 0.01)
+                if (alpha < alpha_threshold)
                     continue;
 
+                if (shading)
+                {
+                    // 头灯漫反射, 按梯度模长混合: 均匀区域不着色, 边界处完全着色
+                    // 插值后的梯度向量归一化即为法线
+                    vec4 gradient = texture(gradient_tex, tex_coord);
+                    float len = length(gradient.xyz);
+                    float diffuse = len > 0.0 ? abs(dot(gradient.xyz / len, r.direction)) : 1.0;
+                    alpha *= mix(1.0, 0.2 + 0.8 * diffuse, gradient.w);
+                }
+                if (ambient_occlusion)
+                    alpha *= texture(occlusion_tex, tex_coord * occlusion_scale).r;
+
                 r.count++;
                 r.value = r.value + (alpha - r.value) / float(r.count);
             }
@@ -368,6 +930,70 @@ int OpenglRasterizationFramer::initialize()
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
 
+    const char* mesh_vertex_shader_source = R"(
+        #version 330 core
+        layout (location = 0) in vec3 position;
+        layout (location = 1) in vec2 normal; // 八面体编码, [0, 1]
+        uniform mat4 model;
+        uniform mat4 view;
+        uniform mat4 projection;
+
+        out vec2 ver_Normal;
+        out vec3 ver_FragPos;
+
+        void main()
+        {
+            gl_Position = projection * view * model * vec4(position, 1.0);
+            ver_Normal = normal * 2.0 - 1.0;
+            ver_FragPos = vec3(model * vec4(position, 1.0));
+        }
+    )";
+    const char* mesh_fragment_shader_source = R"(
+        #version 330 core
+        uniform vec3 camera_position;
+
+        in vec2 ver_Normal;
+        in vec3 ver_FragPos;
+        out vec4 FragColor;
+
+        vec3 decode_octahedral(vec2 e)
+        {
+            vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+            if (n.z < 0.0)
+                n.xy = (1.0 - abs(n.yx)) * mix(vec2(-1.0), vec2(1.0), greaterThanEqual(n.xy, vec2(0.0)));
+            return normalize(n);
+        }
+
+        void main()
+        {
+            // 头灯漫反射, 背面同样着色以便看到被切开的表面内侧
+            vec3 normal = decode_octahedral(ver_Normal);
+            float diffuse = abs(dot(normal, normalize(camera_position - ver_FragPos)));
+            FragColor = vec4(vec3(0.15 + 0.85 * diffuse), 1.0);
+        }
+    )";
+
+    vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex_shader, 1, &mesh_vertex_shader_source, nullptr);
+    glCompileShader(vertex_shader);
+    if (!check_compile_errors(vertex_shader))
+        return code_err("Mesh vertex shader compilation failed");
+
+    fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment_shader, 1, &mesh_fragment_shader_source, nullptr);
+    glCompileShader(fragment_shader);
+    if (!check_compile_errors(fragment_shader))
+        return code_err("Mesh fragment shader compilation failed");
+
+    mesh_program = glCreateProgram();
+    glAttachShader(mesh_program, vertex_shader);
+    glAttachShader(mesh_program, fragment_shader);
+    glLinkProgram(mesh_program);
+    if (!check_link_errors(mesh_program))
+        return code_err("Mesh program linking failed");
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
     glGenFramebuffers(1, &user_framebuffer_id);
     glBindFramebuffer(GL_FRAMEBUFFER, user_framebuffer_id);
 
@@ -378,6 +1004,12 @@ int OpenglRasterizationFramer::initialize()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, render_texture, 0);
+    // 网格绘制需要深度测试, 光线步进不使用
+    glGenRenderbuffers(1, &user_depth_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, user_depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, view_width, view_height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, user_depth_buffer);
     if (GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE)
         return code_err("Framebuffer is not complete! (status: {})", (int)status);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -412,10 +1044,58 @@ void OpenglRasterizationFramer::next_frame()
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_3D, vol_le_tex);
     glUniform1i(glGetUniformLocation(user_program, "volume1_tex"), 0);
+    glUniform1i(glGetUniformLocation(user_program, "volume_lod"), volume_lod);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, macro_cell_tex);
+    glUniform1i(glGetUniformLocation(user_program, "macro_cell_tex"), 1);
+    glUniform1i(glGetUniformLocation(user_program, "macro_cell_size"), vol_le_cells.cell_size);
+    glUniform1i(glGetUniformLocation(user_program, "skip_empty"), skip_empty_cells && macro_cell_tex != 0);
+    glUniform1f(glGetUniformLocation(user_program, "alpha_threshold"), alpha_threshold);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, vol_label_tex);
+    glUniform1i(glGetUniformLocation(user_program, "label_tex"), 2);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, material_brick_tex);
+    glUniform1i(glGetUniformLocation(user_program, "material_brick_tex"), 3);
+    glUniform1i(glGetUniformLocation(user_program, "material_brick_size"), vol_label_bricks.brick_size);
+    glUniform1i(glGetUniformLocation(user_program, "material_filter"), material_filter && material_brick_tex != 0);
+    std::array<GLuint, 8> selection_words{};
+    for (int label = 0; label < 256; ++label)
+        if (material_selection[label])
+            selection_words[label >> 5] |= 1u << (label & 31);
+    glUniform1uiv(glGetUniformLocation(user_program, "material_selection"), 8, selection_words.data());
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_3D, gradient_tex);
+    glUniform1i(glGetUniformLocation(user_program, "gradient_tex"), 4);
+    glUniform1i(glGetUniformLocation(user_program, "shading"), shading && not vol_le_gradient.packed.memory.empty());
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, occlusion_tex);
+    glUniform1i(glGetUniformLocation(user_program, "occlusion_tex"), 5);
+    bool occlusion_ready = not vol_le_occlusion.occlusion.memory.empty();
+    glUniform1i(glGetUniformLocation(user_program, "ambient_occlusion"), ambient_occlusion && occlusion_ready);
+    glUniform3fv(glGetUniformLocation(user_program, "occlusion_scale"), 1, glm::value_ptr(occlusion_ready ? vol_le_occlusion.texture_scale() : glm::vec3(1.0f)));
+    glActiveTexture(GL_TEXTURE0);
     glUniform3fv(glGetUniformLocation(user_program, "camera_position"), 1, glm::value_ptr(cam.position));
 
     glBindVertexArray(user_vertex_array_object);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    if (render_mode == 0)
+        glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+    if (render_mode == 0 && cpu_reference_requested)
+        compare_cpu_reference(cam);
+
+    if (render_mode == 2 && mesh_index_count > 0)
+    {
+        glEnable(GL_DEPTH_TEST);
+        glUseProgram(mesh_program);
+        glUniformMatrix4fv(glGetUniformLocation(mesh_program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        glUniformMatrix4fv(glGetUniformLocation(mesh_program, "view"), 1, GL_FALSE, glm::value_ptr(cam.view()));
+        glUniformMatrix4fv(glGetUniformLocation(mesh_program, "projection"), 1, GL_FALSE, glm::value_ptr(cam.projection()));
+        glUniform3fv(glGetUniformLocation(mesh_program, "camera_position"), 1, glm::value_ptr(cam.position));
+        glBindVertexArray(mesh_vertex_array_object);
+        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh_index_count), GL_UNSIGNED_INT, 0);
+        glDisable(GL_DEPTH_TEST);
+    }
+    glBindVertexArray(0);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
     update();
@@ -427,9 +1107,19 @@ void OpenglRasterizationFramer::destroy()
         glDeleteVertexArrays(1, &user_vertex_array_object);
     if (user_program != 0)
         glDeleteProgram(user_program);
+    if (mesh_vertex_array_object != 0)
+        glDeleteVertexArrays(1, &mesh_vertex_array_object);
+    if (mesh_vertex_buffer != 0)
+        glDeleteBuffers(1, &mesh_vertex_buffer);
+    if (mesh_element_buffer != 0)
+        glDeleteBuffers(1, &mesh_element_buffer);
+    if (mesh_program != 0)
+        glDeleteProgram(mesh_program);
     uninit();
     if (render_texture != 0)
         glDeleteTextures(1, &render_texture);
+    if (user_depth_buffer != 0)
+        glDeleteRenderbuffers(1, &user_depth_buffer);
     if (user_framebuffer_id != 0)
         glDeleteFramebuffers(1, &user_framebuffer_id);
 }
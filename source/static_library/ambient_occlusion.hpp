@@ -0,0 +1,199 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/voxel.hpp"
+#include "macro_cell_grid.hpp"
+#include "mip_pyramid.hpp"
+#include "parallel_for.hpp"
+
+// 按传输函数烘焙的低分辨率环境光遮蔽体, 每个单元 (cell_size^3 个体素) 一个值, 1 为完全不被遮挡
+// 先求每个单元的平均不透明度, 再在其 mip 金字塔上沿若干方向做锥追踪, 距离每加倍就读更粗一级
+// 传输函数改变时, 只有值域 [min, max] 与变化区间相交的单元需要重新统计不透明度
+// pyramid 引用 opacity 的内存, 因此禁止拷贝; 移动时 vector 的缓冲区不变, 引用仍然有效
+struct occlusion_cache
+{
+    int cell_size = 8;
+    int cone_steps = 6;     // 每个方向的采样次数, 第 i 次读取第 i 级
+    float strength = 1.0f;  // 每次采样的不透明度乘以 strength
+    glm::ivec3 volume_size{ 0 };
+    macro_cell_grid<uint16_t> ranges; // 无边界的单元值域, 用于判断哪些单元受传输函数变化影响
+    voxel<float> opacity;             // 每单元的平均不透明度
+    mip_pyramid<float> pyramid;
+    voxel<float> occlusion;
+    std::vector<float> transfer; // 上次使用的不透明度表
+
+    occlusion_cache() = default;
+    occlusion_cache(const occlusion_cache&) = delete;
+    occlusion_cache& operator=(const occlusion_cache&) = delete;
+    occlusion_cache(occlusion_cache&&) noexcept = default;
+    occlusion_cache& operator=(occlusion_cache&&) noexcept = default;
+
+    // 单元网格覆盖 occlusion.size * cell_size 个体素, 比体数据略大; 体数据的归一化纹理坐标乘以该值后才对应遮蔽体的纹理坐标
+    glm::vec3 texture_scale() const { return glm::vec3(volume_size) / glm::vec3(occlusion.size * cell_size); }
+
+    // 体素坐标处的遮蔽值, 最近邻
+    float sample(glm::ivec3 voxel_coord) const
+    {
+        glm::ivec3 cell = glm::clamp(voxel_coord / cell_size, glm::ivec3(0), occlusion.size - 1);
+        return occlusion(cell.x, cell.y, cell.z);
+    }
+};
+
+// 与 OpenglRasterizationFramer 片段着色器一致的传输函数: alpha = 值 * value_scale, 低于 threshold 时透明
+static inline std::vector<float> make_threshold_opacity(float threshold, float value_scale = 1.0f / 256.0f)
+{
+    std::vector<float> table(65536);
+    for (size_t v = 0; v < table.size(); ++v)
+    {
+        float alpha = static_cast<float>(v) * value_scale;
+        table[v] = alpha < threshold ? 0.0f : std::min(alpha, 1.0f);
+    }
+    return table;
+}
+
+namespace ambient_occlusion_detail
+{
+    // 6 个轴向 + 8 个对角方向, 大致均匀覆盖整个球面
+    static inline std::array<glm::vec3, 14> cone_directions()
+    {
+        std::array<glm::vec3, 14> dirs;
+        int n = 0;
+        for (int axis = 0; axis < 3; ++axis)
+            for (int sign = -1; sign <= 1; sign += 2)
+            {
+                glm::vec3 d(0.0f);
+                d[axis] = static_cast<float>(sign);
+                dirs[n++] = d;
+            }
+        for (int i = 0; i < 8; ++i)
+            dirs[n++] = glm::normalize(glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f));
+        return dirs;
+    }
+
+    // 统计单元平均不透明度, affected(cell) 为 false 的单元保持原值, 返回重新统计的单元数
+    template <typename Affected> static inline size_t accumulate_opacity(occlusion_cache& cache, volume_view<const uint16_t> vol, std::span<const float> lut, Affected&& affected)
+    {
+        glm::ivec3 size = cache.opacity.size;
+        size_t last = lut.size() - 1;
+        std::atomic<size_t> updated{ 0 };
+        parallel_for(0, static_cast<size_t>(size.y) * size.z, 1, [&](size_t begin, size_t end) {
+            size_t count = 0;
+            for (size_t row = begin; row < end; ++row)
+            {
+                int cy = static_cast<int>(row % size.y);
+                int cz = static_cast<int>(row / size.y);
+                int y0 = cy * cache.cell_size, y1 = std::min(y0 + cache.cell_size, vol.size.y);
+                int z0 = cz * cache.cell_size, z1 = std::min(z0 + cache.cell_size, vol.size.z);
+                for (int cx = 0; cx < size.x; ++cx)
+                {
+                    if (not affected(glm::ivec3(cx, cy, cz)))
+                        continue;
+                    int x0 = cx * cache.cell_size, x1 = std::min(x0 + cache.cell_size, vol.size.x);
+                    float sum = 0.0f;
+                    for (int z = z0; z < z1; ++z)
+                        for (int y = y0; y < y1; ++y)
+                        {
+                            const uint16_t* in = &vol(0, y, z);
+                            for (int x = x0; x < x1; ++x)
+                                sum += lut[std::min<size_t>(in[x], last)];
+                        }
+                    cache.opacity(cx, cy, cz) = sum / static_cast<float>((x1 - x0) * (y1 - y0) * (z1 - z0));
+                    ++count;
+                }
+            }
+            updated += count;
+        });
+        return updated;
+    }
+
+    static inline void trace_cones(occlusion_cache& cache)
+    {
+        static const auto dirs = cone_directions();
+        glm::ivec3 size = cache.opacity.size;
+        glm::vec3 extent = glm::vec3(size);
+        int levels = std::min(cache.cone_steps, cache.pyramid.level_count());
+        parallel_for(0, static_cast<size_t>(size.y) * size.z, 4, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; ++row)
+            {
+                int cy = static_cast<int>(row % size.y);
+                int cz = static_cast<int>(row / size.y);
+                for (int cx = 0; cx < size.x; ++cx)
+                {
+                    glm::vec3 center = glm::vec3(cx, cy, cz) + 0.5f;
+                    float visibility = 0.0f;
+                    for (const auto& dir : dirs)
+                    {
+                        float transmittance = 1.0f;
+                        // 第 level 次采样位于 2^level 个单元之外, 覆盖范围与该级的单元尺寸相当
+                        for (int level = 0; level < levels; ++level)
+                        {
+                            glm::vec3 p = center + dir * static_cast<float>(1 << level);
+                            if (glm::any(glm::lessThan(p, glm::vec3(0.0f))) || glm::any(glm::greaterThanEqual(p, extent)))
+                                break;
+                            float alpha = std::min(cache.pyramid.sample(level, p / extent) * cache.strength, 1.0f);
+                            transmittance *= 1.0f - alpha;
+                        }
+                        visibility += transmittance;
+                    }
+                    cache.occlusion(cx, cy, cz) = visibility / static_cast<float>(dirs.size());
+                }
+            }
+        });
+    }
+} // namespace ambient_occlusion_detail
+
+// 按新的不透明度表 (下标为体素值, 超出表长的值取最后一项) 更新遮蔽体, 返回是否重新烘焙
+// 第一次调用或体数据尺寸变化时完整构建; 之后只重新统计受影响的单元, 没有单元变化时直接返回
+static inline bool update_occlusion_cache(occlusion_cache& cache, volume_view<const uint16_t> vol, std::span<const float> opacity_lut)
+{
+    using namespace ambient_occlusion_detail;
+    if (opacity_lut.empty() || vol.memory.empty())
+        return false;
+
+    bool rebuild = cache.volume_size != vol.size || cache.transfer.empty();
+    if (rebuild)
+    {
+        cache.cell_size = std::max(cache.cell_size, 1);
+        cache.volume_size = vol.size;
+        cache.ranges = build_macro_cell_grid<uint16_t>(vol, cache.cell_size, 0);
+        cache.opacity = make_voxel<float>(cache.ranges.grid_size());
+        cache.occlusion = make_voxel<float>(cache.ranges.grid_size());
+        accumulate_opacity(cache, vol, opacity_lut, [](glm::ivec3) { return true; });
+    }
+    else
+    {
+        // 变化区间 [lo, hi], 表长不同时视为整表变化
+        size_t lo = 0, hi = opacity_lut.size() - 1;
+        if (cache.transfer.size() == opacity_lut.size())
+        {
+            while (lo <= hi && cache.transfer[lo] == opacity_lut[lo])
+                ++lo;
+            if (lo > hi)
+                return false;
+            while (cache.transfer[hi] == opacity_lut[hi])
+                --hi;
+        }
+        size_t last = opacity_lut.size() - 1;
+        auto affected = [&](glm::ivec3 cell) {
+            auto range = cache.ranges.range(cell);
+            return std::min<size_t>(range.x, last) <= hi && std::min<size_t>(range.y, last) >= lo;
+        };
+        if (accumulate_opacity(cache, vol, opacity_lut, affected) == 0)
+        {
+            cache.transfer.assign(opacity_lut.begin(), opacity_lut.end());
+            return false;
+        }
+    }
+    cache.transfer.assign(opacity_lut.begin(), opacity_lut.end());
+    cache.pyramid = build_mip_pyramid<float>(cache.opacity, mip_reduction::average, cache.cone_steps);
+    trace_cones(cache);
+    return true;
+}
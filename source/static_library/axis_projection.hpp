@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/pixel.hpp"
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+enum class projection_reduction
+{
+    max,  // MIP
+    min,  // MinIP
+    mean, // 平均
+    sum,  // 求和, 整数结果超出 R 的范围时饱和
+};
+
+namespace axis_projection_detail
+{
+    template <typename T> using accumulate_t = std::conditional_t<std::is_floating_point_v<T>, double, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+    // 8/16 位整数沿不超过 65536 个体素求和时 32 位累加器不会溢出, 向量化宽度翻倍
+    template <typename T> using narrow_accumulate_t = std::conditional_t<std::is_signed_v<T>, int32_t, uint32_t>;
+    template <typename T> static inline bool fits_narrow(int extent)
+    {
+        return std::is_integral_v<T> && sizeof(T) <= 2 && extent <= 65536;
+    }
+
+    template <typename R, typename A> static inline R finish(A value)
+    {
+        if constexpr (std::is_floating_point_v<R>)
+            return static_cast<R>(value);
+        else
+        {
+            if constexpr (std::is_floating_point_v<A>)
+                value = std::round(value);
+            return static_cast<R>(std::clamp<A>(value, static_cast<A>(std::numeric_limits<R>::lowest()), static_cast<A>(std::numeric_limits<R>::max())));
+        }
+    }
+
+    // 所有轴都按行读取连续内存, 行内循环没有分支, 交给编译器向量化
+    // z: 每个线程累加若干整层到私有图像后合并; y: 每个线程负责若干 z 层, 层内逐行累加; x: 每行做一次归约
+    template <typename R, typename A, typename T, typename Op, typename Finish>
+    static inline pixel<R> project(volume_view<const T> vol, int axis, A init, Op&& op, Finish&& done)
+    {
+        glm::ivec3 size = vol.size;
+        glm::ivec2 out_size = axis == 0 ? glm::ivec2(size.y, size.z) : axis == 1 ? glm::ivec2(size.x, size.z) : glm::ivec2(size.x, size.y);
+        pixel<R> out = make_pixel<R>(out_size);
+        if (out.memory.empty())
+            return out;
+
+        if (axis == 2)
+        {
+            // 按 z 层顺序读取整层, 每个工作线程累加到私有图像, 最后按行合并
+            size_t plane = static_cast<size_t>(size.x) * size.y;
+            std::vector<std::vector<A>> partial(parallel_worker_count());
+            parallel_for_workers(0, static_cast<size_t>(size.z), 4, [&](size_t worker, size_t begin, size_t end) {
+                auto& acc = partial[worker];
+                if (acc.empty())
+                    acc.assign(plane, init);
+                for (size_t z = begin; z < end; ++z)
+                {
+                    const T* slice = &vol(0, 0, static_cast<int>(z));
+                    for (size_t i = 0; i < plane; ++i)
+                        acc[i] = op(acc[i], static_cast<A>(slice[i]));
+                }
+            });
+            parallel_for(0, static_cast<size_t>(size.y), 8, [&](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; ++y)
+                {
+                    R* dst = &out(0, static_cast<int>(y));
+                    for (int x = 0; x < size.x; ++x)
+                    {
+                        A value = init;
+                        for (const auto& acc : partial)
+                            if (not acc.empty())
+                                value = op(value, acc[y * size.x + x]);
+                        dst[x] = done(value, size.z);
+                    }
+                }
+            });
+        }
+        else if (axis == 1)
+        {
+            parallel_for(0, static_cast<size_t>(size.z), 1, [&](size_t begin, size_t end) {
+                std::vector<A> acc(static_cast<size_t>(size.x));
+                for (size_t z = begin; z < end; ++z)
+                {
+                    std::fill(acc.begin(), acc.end(), init);
+                    for (int y = 0; y < size.y; ++y)
+                    {
+                        const T* row = &vol(0, y, static_cast<int>(z));
+                        for (int x = 0; x < size.x; ++x)
+                            acc[x] = op(acc[x], static_cast<A>(row[x]));
+                    }
+                    R* dst = &out(0, static_cast<int>(z));
+                    for (int x = 0; x < size.x; ++x)
+                        dst[x] = done(acc[x], size.y);
+                }
+            });
+        }
+        else
+        {
+            parallel_for(0, static_cast<size_t>(size.z), 1, [&](size_t begin, size_t end) {
+                for (size_t z = begin; z < end; ++z)
+                    for (int y = 0; y < size.y; ++y)
+                    {
+                        const T* row = &vol(0, y, static_cast<int>(z));
+                        A acc = init;
+                        for (int x = 0; x < size.x; ++x)
+                            acc = op(acc, static_cast<A>(row[x]));
+                        out(y, static_cast<int>(z)) = done(acc, size.x);
+                    }
+            });
+        }
+        return out;
+    }
+} // namespace axis_projection_detail
+
+// 沿 axis (0: x, 1: y, 2: z) 投影, 结果为剩余两个轴按 (x, y, z) 顺序组成的图像
+// 例如沿 z 投影得到 (x, y), 沿 x 投影得到 (y, z)
+template <typename R = void, typename T> static inline auto project_axis(volume_view<const T> vol, int axis, projection_reduction reduction)
+{
+    using namespace axis_projection_detail;
+    using result_t = std::conditional_t<std::is_void_v<R>, T, R>;
+    using A = accumulate_t<T>;
+    axis = std::clamp(axis, 0, 2);
+    switch (reduction)
+    {
+        case projection_reduction::max:
+            return project<result_t, T>(vol, axis, std::numeric_limits<T>::lowest(), [](T a, T b) { return a > b ? a : b; }, [](T v, int) { return static_cast<result_t>(v); });
+        case projection_reduction::min:
+            return project<result_t, T>(vol, axis, std::numeric_limits<T>::max(), [](T a, T b) { return a < b ? a : b; }, [](T v, int) { return static_cast<result_t>(v); });
+        case projection_reduction::mean:
+        case projection_reduction::sum:
+        default:
+        {
+            bool mean = reduction == projection_reduction::mean;
+            auto done = [mean](auto v, int n) {
+                if (mean)
+                    return finish<result_t>(static_cast<double>(v) / static_cast<double>(std::max(n, 1)));
+                return finish<result_t>(v);
+            };
+            if constexpr (std::is_integral_v<T> && sizeof(T) <= 2)
+            {
+                using N = narrow_accumulate_t<T>;
+                if (fits_narrow<T>(vol.size[axis]))
+                    return project<result_t, N>(vol, axis, N(0), [](N a, N b) { return static_cast<N>(a + b); }, done);
+            }
+            return project<result_t, A>(vol, axis, A(0), [](A a, A b) { return a + b; }, done);
+        }
+    }
+}
+template <typename R = void, typename T, typename Layout> static inline auto project_axis(const voxel<T, Layout>& vol, int axis, projection_reduction reduction)
+{
+    if constexpr (std::is_same_v<Layout, std::layout_right>)
+        return project_axis<R>(as_view(vol), axis, reduction);
+    else
+        return project_axis<R>(as_view(relayout<std::layout_right>(vol)), axis, reduction);
+}
@@ -0,0 +1,314 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/voxel.hpp"
+#include "material_brick_index.hpp"
+#include "parallel_for.hpp"
+
+enum class connectivity
+{
+    face = 6,    // 共面
+    edge = 18,   // 共面或共棱
+    vertex = 26, // 共面, 共棱或共顶点
+};
+
+// 一个连通区域的统计, 坐标范围 [min, max] 含端点
+struct component_info
+{
+    uint64_t voxel_count = 0;
+    glm::ivec3 min{ std::numeric_limits<int>::max() };
+    glm::ivec3 max{ std::numeric_limits<int>::lowest() };
+    double mean_le = 0.0;
+    double mean_he = 0.0;
+};
+
+// labels 中 0 为背景, 区域 i 的标签为 i + 1, 统计信息为 components[i]
+struct connected_components
+{
+    voxel<uint32_t> labels;
+    std::vector<component_info> components;
+};
+
+namespace connected_components_detail
+{
+    // 在光栅顺序 (z, y, x) 中位于当前体素之前的邻居
+    static inline std::vector<glm::ivec3> backward_neighbors(connectivity conn)
+    {
+        int max_axes = conn == connectivity::face ? 1 : conn == connectivity::edge ? 2 : 3;
+        std::vector<glm::ivec3> offsets;
+        for (int dz = -1; dz <= 0; ++dz)
+            for (int dy = -1; dy <= 1; ++dy)
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    if (dz == 0 && (dy > 0 || (dy == 0 && dx >= 0)))
+                        continue;
+                    if (std::abs(dx) + std::abs(dy) + std::abs(dz) <= max_axes)
+                        offsets.push_back({ dx, dy, dz });
+                }
+        return offsets;
+    }
+
+    // 并查集, 根总是集合中最小的序号, 合并结果与合并顺序无关
+    struct union_find
+    {
+        std::vector<uint32_t> parent;
+
+        uint32_t make()
+        {
+            parent.push_back(static_cast<uint32_t>(parent.size()));
+            return parent.back();
+        }
+        uint32_t find(uint32_t a)
+        {
+            while (parent[a] != a)
+                a = parent[a] = parent[parent[a]];
+            return a;
+        }
+        void unite(uint32_t a, uint32_t b)
+        {
+            a = find(a);
+            b = find(b);
+            if (a < b)
+                parent[b] = a;
+            else if (b < a)
+                parent[a] = b;
+        }
+    };
+
+    struct accumulator
+    {
+        uint64_t count = 0;
+        glm::ivec3 min{ std::numeric_limits<int>::max() };
+        glm::ivec3 max{ std::numeric_limits<int>::lowest() };
+        double sum_le = 0.0;
+        double sum_he = 0.0;
+
+        void merge(const accumulator& other)
+        {
+            count += other.count;
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+            sum_le += other.sum_le;
+            sum_he += other.sum_he;
+        }
+    };
+
+    // 一段 z 层 [z0, z1) 的局部标记结果, 标签为 1 ~ stats.size() 的局部序号
+    struct slab
+    {
+        int z0 = 0;
+        int z1 = 0;
+        uint32_t offset = 0; // 局部序号在全局序号中的起点
+        std::vector<accumulator> stats;
+    };
+} // namespace connected_components_detail
+
+// 多线程三维连通区域标记, 前景为 classes 中的材料类别
+// 体数据按 z 方向切成若干段, 每段独立做两遍扫描的局部标记并在第二遍同时统计体素数, 包围盒和 LE/HE 和
+// 之后只在段间边界平面上用并查集合并, 最后并行改写为全局连续标签
+// le / he 为空时不统计均值
+static inline connected_components label_connected_components(volume_view<const uint8_t> classes, const material_set& selection, connectivity conn = connectivity::vertex,
+                                                              volume_view<const uint16_t> le = {}, volume_view<const uint16_t> he = {}, int slab_depth = 0)
+{
+    using namespace connected_components_detail;
+    connected_components result;
+    glm::ivec3 size = classes.size;
+    result.labels = make_voxel<uint32_t>(size);
+    if (result.labels.memory.empty())
+        return result;
+
+    std::array<bool, 256> foreground{};
+    for (int label = 0; label < 256; ++label)
+        foreground[label] = selection[label];
+    bool with_le = le.size == size && not le.memory.empty();
+    bool with_he = he.size == size && not he.memory.empty();
+    auto neighbors = backward_neighbors(conn);
+
+    if (slab_depth <= 0)
+        slab_depth = std::max(4, size.z / static_cast<int>(parallel_worker_count() * 4));
+    std::vector<slab> slabs;
+    for (int z = 0; z < size.z; z += slab_depth)
+        slabs.push_back({ z, std::min(z + slab_depth, size.z) });
+
+    auto& labels = result.labels;
+    parallel_for(0, slabs.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s)
+        {
+            auto& part = slabs[s];
+            // 第一遍: 取已访问邻居中的标签, 记录等价关系, 0 号为背景占位
+            union_find local;
+            local.make();
+            for (int z = part.z0; z < part.z1; ++z)
+                for (int y = 0; y < size.y; ++y)
+                {
+                    const uint8_t* in = &classes(0, y, z);
+                    uint32_t* out = &labels(0, y, z);
+                    for (int x = 0; x < size.x; ++x)
+                    {
+                        if (not foreground[in[x]])
+                        {
+                            out[x] = 0;
+                            continue;
+                        }
+                        uint32_t current = 0;
+                        for (auto d : neighbors)
+                        {
+                            glm::ivec3 n = glm::ivec3(x, y, z) + d;
+                            if (n.x < 0 || n.x >= size.x || n.y < 0 || n.y >= size.y || n.z < part.z0)
+                                continue;
+                            uint32_t other = labels(n.x, n.y, n.z);
+                            if (other == 0)
+                                continue;
+                            if (current == 0)
+                                current = other;
+                            else if (other != current)
+                                local.unite(current, other);
+                        }
+                        out[x] = current != 0 ? current : local.make();
+                    }
+                }
+
+            // 第二遍: 压缩为连续的局部序号并累加统计
+            std::vector<uint32_t> compact(local.parent.size(), 0);
+            for (uint32_t i = 1; i < local.parent.size(); ++i)
+            {
+                uint32_t root = local.find(i);
+                if (root == i)
+                {
+                    part.stats.emplace_back();
+                    compact[i] = static_cast<uint32_t>(part.stats.size());
+                }
+                else
+                    compact[i] = compact[root];
+            }
+            for (int z = part.z0; z < part.z1; ++z)
+                for (int y = 0; y < size.y; ++y)
+                {
+                    uint32_t* out = &labels(0, y, z);
+                    for (int x = 0; x < size.x; ++x)
+                    {
+                        if (out[x] == 0)
+                            continue;
+                        out[x] = compact[out[x]];
+                        auto& acc = part.stats[out[x] - 1];
+                        acc.count++;
+                        acc.min = glm::min(acc.min, glm::ivec3(x, y, z));
+                        acc.max = glm::max(acc.max, glm::ivec3(x, y, z));
+                        if (with_le)
+                            acc.sum_le += le(x, y, z);
+                        if (with_he)
+                            acc.sum_he += he(x, y, z);
+                    }
+                }
+        }
+    });
+
+    // 全局序号 = 段起点 + 局部序号 - 1
+    uint32_t total = 0;
+    for (auto& part : slabs)
+    {
+        part.offset = total;
+        total += static_cast<uint32_t>(part.stats.size());
+    }
+    union_find global;
+    global.parent.resize(total);
+    for (uint32_t i = 0; i < total; ++i)
+        global.parent[i] = i;
+
+    // 段间边界: 每个边界平面独立收集等价对, 再串行合并
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> pairs(slabs.size());
+    parallel_for(1, slabs.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s)
+        {
+            int z = slabs[s].z0;
+            auto& found = pairs[s];
+            for (int y = 0; y < size.y; ++y)
+                for (int x = 0; x < size.x; ++x)
+                {
+                    uint32_t a = labels(x, y, z);
+                    if (a == 0)
+                        continue;
+                    uint32_t ga = slabs[s].offset + a - 1;
+                    for (auto d : neighbors)
+                    {
+                        if (d.z != -1)
+                            continue;
+                        int nx = x + d.x, ny = y + d.y;
+                        if (nx < 0 || nx >= size.x || ny < 0 || ny >= size.y)
+                            continue;
+                        uint32_t b = labels(nx, ny, z - 1);
+                        if (b == 0)
+                            continue;
+                        uint32_t gb = slabs[s - 1].offset + b - 1;
+                        if (found.empty() || found.back() != std::pair(ga, gb))
+                            found.emplace_back(ga, gb);
+                    }
+                }
+        }
+    });
+    for (const auto& found : pairs)
+        for (auto [a, b] : found)
+            global.unite(a, b);
+
+    // 根按序号顺序编号, 标签顺序与首次出现的光栅顺序一致
+    std::vector<uint32_t> final_label(total, 0);
+    std::vector<accumulator> merged;
+    for (uint32_t i = 0; i < total; ++i)
+    {
+        uint32_t root = global.find(i);
+        if (root == i)
+        {
+            merged.emplace_back();
+            final_label[i] = static_cast<uint32_t>(merged.size());
+        }
+        else
+            final_label[i] = final_label[root];
+    }
+    for (const auto& part : slabs)
+        for (size_t i = 0; i < part.stats.size(); ++i)
+            merged[final_label[part.offset + i] - 1].merge(part.stats[i]);
+
+    parallel_for(0, slabs.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; ++s)
+        {
+            const uint32_t* remap = final_label.data() + slabs[s].offset;
+            for (int z = slabs[s].z0; z < slabs[s].z1; ++z)
+                for (int y = 0; y < size.y; ++y)
+                {
+                    uint32_t* out = &labels(0, y, z);
+                    for (int x = 0; x < size.x; ++x)
+                        out[x] = out[x] == 0 ? 0 : remap[out[x] - 1];
+                }
+        }
+    });
+
+    result.components.resize(merged.size());
+    for (size_t i = 0; i < merged.size(); ++i)
+    {
+        auto& info = result.components[i];
+        const auto& acc = merged[i];
+        info.voxel_count = acc.count;
+        info.min = acc.min;
+        info.max = acc.max;
+        info.mean_le = acc.count == 0 ? 0.0 : acc.sum_le / static_cast<double>(acc.count);
+        info.mean_he = acc.count == 0 ? 0.0 : acc.sum_he / static_cast<double>(acc.count);
+    }
+    return result;
+}
+static inline connected_components label_connected_components(const voxel<uint8_t>& classes, const material_set& selection, connectivity conn = connectivity::vertex)
+{
+    return label_connected_components(as_view(classes), selection, conn);
+}
+static inline connected_components label_connected_components(const voxel<uint8_t>& classes, const material_set& selection, connectivity conn, const voxel<uint16_t>& le,
+                                                              const voxel<uint16_t>& he)
+{
+    return label_connected_components(as_view(classes), selection, conn, as_view(le), as_view(he));
+}
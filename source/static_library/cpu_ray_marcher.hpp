@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "camera_info.hpp"
+#include "interface/pixel.hpp"
+#include "interface/voxel.hpp"
+#include "macro_cell_grid.hpp"
+#include "parallel_for.hpp"
+#include "render_kernel.hpp"
+
+// 默认值与 OpenglRasterizationFramer 片段着色器一致
+template <typename T = uint16_t> struct cpu_ray_march_options
+{
+    float step = 0.005f;
+    int max_steps = 10000;
+    float alpha_threshold = 0.01f;
+    float value_scale = 1.0f / 256.0f; // alpha = 体素值 * value_scale
+    sample_filter filter = sample_filter::nearest;
+    composite_mode composite = composite_mode::mean;
+    uint32_t background = 0;                   // 光线未进入立方体时的颜色 (RGBA8)
+    int tile_size = 16;                        // 调度粒度, 每块 tile_size * tile_size 像素
+    const macro_cell_grid<T>* cells = nullptr; // 非空时跳过空宏单元, 结果不变 (单元边界须 >= 1)
+};
+
+namespace cpu_ray_marcher_detail
+{
+    constexpr int packet_size = 8;
+
+    // 一个光线包, 每个分量独立存放以便编译器向量化
+    template <typename Compositor> struct ray_packet
+    {
+        alignas(32) float px[packet_size], py[packet_size], pz[packet_size]; // 进入立方体的位置
+        alignas(32) float dx[packet_size], dy[packet_size], dz[packet_size];
+        alignas(32) int step[packet_size];
+        alignas(32) int alive[packet_size];
+        Compositor composite[packet_size];
+    };
+
+    // 光线与 [-0.5, 0.5] 立方体求交, 返回进入距离, 未命中返回负数
+    static inline float enter_cube(glm::vec3 origin, glm::vec3 direction)
+    {
+        float t0 = -1e30f, t1 = 1e30f;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (std::abs(direction[i]) < 1e-12f)
+            {
+                if (origin[i] < -0.5f || origin[i] > 0.5f)
+                    return -1.0f;
+                continue;
+            }
+            float a = (-0.5f - origin[i]) / direction[i];
+            float b = (0.5f - origin[i]) / direction[i];
+            t0 = std::max(t0, std::min(a, b));
+            t1 = std::min(t1, std::max(a, b));
+        }
+        return t0 <= t1 ? t0 : -1.0f;
+    }
+
+    static inline uint32_t pack_gray(float value)
+    {
+        auto c = static_cast<uint32_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+        return 0xff000000u | (c << 16) | (c << 8) | c;
+    }
+
+    template <typename T, typename Layout> struct frame
+    {
+        const camera_info& cam;
+        volume_view<const T, Layout> vol;
+        pixel<uint32_t>& target;
+        const cpu_ray_march_options<T>& options;
+    };
+
+    template <typename T, typename Layout> struct kernels
+    {
+        // 每次迭代所有通道都执行同样的指令, 结束的通道和空单元只通过掩码 (0 / 1) 和选择屏蔽, 内层循环没有分支
+        // 采样器对坐标做了截断, 屏蔽的通道照常读取也不会越界; 体素读取仍是每通道一次的标量 gather
+        template <sample_filter F, composite_mode C, bool Skip> static void trace_packet(ray_packet<render_kernel::compositor<C>>& packet, const frame<T, Layout>& f)
+        {
+            const auto& vol = f.vol;
+            const auto& options = f.options;
+            glm::vec3 size = glm::vec3(vol.size);
+            float step = options.step;
+            float step_limit = static_cast<float>(options.max_steps);
+            float skip_limit = options.alpha_threshold / options.value_scale;
+
+            for (;;)
+            {
+                int any_alive = 0;
+                for (int l = 0; l < packet_size; ++l)
+                {
+                    int i = packet.step[l];
+                    float t = static_cast<float>(i);
+                    // 与着色器相同的运算顺序: position + direction * float(i) * step
+                    float cx = packet.px[l] + packet.dx[l] * t * step;
+                    float cy = packet.py[l] + packet.dy[l] * t * step;
+                    float cz = packet.pz[l] + packet.dz[l] * t * step;
+                    int inside = packet.alive[l] & (i < options.max_steps) & (cx >= -0.5f) & (cy >= -0.5f) & (cz >= -0.5f) & (cx <= 0.5f) & (cy <= 0.5f) & (cz <= 0.5f);
+                    glm::vec3 tex = glm::vec3(cx, cy, cz) + glm::vec3(0.5f);
+
+                    int empty = 0;
+                    int next = i + 1;
+                    if constexpr (Skip)
+                    {
+                        // 跳到单元出口之后的第一个采样点, 与着色器中的空域跳跃相同
+                        const auto& cells = *options.cells;
+                        float cell_scale = static_cast<float>(cells.cell_size);
+                        glm::ivec3 v = glm::clamp(glm::ivec3(tex * size), glm::ivec3(0), vol.size - 1);
+                        glm::ivec3 cell = glm::clamp(v / cells.cell_size, glm::ivec3(0), cells.cells.size - 1);
+                        empty = static_cast<float>(cells.cells(cell.x, cell.y, cell.z).y) < skip_limit;
+                        glm::vec3 lo = glm::vec3(cell) * cell_scale / size - glm::vec3(0.5f);
+                        glm::vec3 hi = glm::vec3(cell + 1) * cell_scale / size - glm::vec3(0.5f);
+                        float d[3] = { packet.dx[l], packet.dy[l], packet.dz[l] };
+                        float p[3] = { packet.px[l], packet.py[l], packet.pz[l] };
+                        float t_exit = 1e30f;
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            float t_far = std::max((lo[k] - p[k]) / d[k], (hi[k] - p[k]) / d[k]);
+                            t_exit = std::min(t_exit, std::abs(d[k]) >= 1e-8f ? t_far : 1e30f);
+                        }
+                        float exit_step = std::min(std::ceil(t_exit / step), step_limit);
+                        next = empty ? std::max(i, static_cast<int>(exit_step) - 1) + 1 : next;
+                    }
+
+                    float alpha = render_kernel::sampler<F>::sample(vol, tex) * options.value_scale;
+                    int hit = inside & (empty ^ 1) & (alpha >= options.alpha_threshold);
+                    int more = packet.composite[l].add(alpha, hit, step);
+                    packet.alive[l] = inside & more;
+                    packet.step[l] = next;
+                    any_alive |= packet.alive[l];
+                }
+                if (not any_alive)
+                    break;
+            }
+        }
+
+        template <sample_filter F, composite_mode C, bool Skip> static void run(const frame<T, Layout>& f)
+        {
+            const auto& cam = f.cam;
+            auto& target = f.target;
+            const auto& options = f.options;
+            glm::ivec2 viewport = target.size;
+
+            glm::vec3 front = cam.front(), up = cam.up(), right = cam.right();
+            float tan_half = std::tan(cam.fov * 0.5f);
+            constexpr float near_plane = 0.1f, far_plane = 1000.0f;
+
+            int tile = std::max(options.tile_size, 1);
+            glm::ivec2 tiles = (viewport + glm::ivec2(tile - 1)) / tile;
+            parallel_for(0, static_cast<size_t>(tiles.x) * tiles.y, 1, [&](size_t begin, size_t end) {
+                ray_packet<render_kernel::compositor<C>> packet{};
+                int columns[packet_size];
+                for (size_t index = begin; index < end; ++index)
+                {
+                    glm::ivec2 lo = glm::ivec2(static_cast<int>(index % tiles.x), static_cast<int>(index / tiles.x)) * tile;
+                    glm::ivec2 hi = glm::min(lo + tile, viewport);
+                    for (int y = lo.y; y < hi.y; ++y)
+                        for (int x0 = lo.x; x0 < hi.x; x0 += packet_size)
+                        {
+                            int lanes = 0;
+                            for (int x = x0; x < std::min(x0 + packet_size, hi.x); ++x)
+                            {
+                                float ndc_x = (static_cast<float>(x) + 0.5f) / static_cast<float>(viewport.x) * 2.0f - 1.0f;
+                                float ndc_y = (static_cast<float>(y) + 0.5f) / static_cast<float>(viewport.y) * 2.0f - 1.0f;
+                                glm::vec3 direction = glm::normalize(front + right * (ndc_x * tan_half * cam.aspect_ratio) + up * (ndc_y * tan_half));
+                                // 只有正面可见: 相机在立方体内或入射点被近平面裁掉时没有片段
+                                float t = enter_cube(cam.position, direction);
+                                float depth = t * glm::dot(direction, front);
+                                if (t <= 0.0f || depth < near_plane || depth > far_plane)
+                                {
+                                    target(x, y) = options.background;
+                                    continue;
+                                }
+                                glm::vec3 entry = cam.position + direction * t;
+                                packet.px[lanes] = entry.x, packet.py[lanes] = entry.y, packet.pz[lanes] = entry.z;
+                                packet.dx[lanes] = direction.x, packet.dy[lanes] = direction.y, packet.dz[lanes] = direction.z;
+                                packet.composite[lanes] = {};
+                                packet.step[lanes] = 0;
+                                packet.alive[lanes] = 1;
+                                columns[lanes++] = x;
+                            }
+                            if (lanes == 0)
+                                continue;
+                            // 不足一个包时剩余通道从一开始就是结束状态
+                            for (int l = lanes; l < packet_size; ++l)
+                                packet.alive[l] = 0;
+                            trace_packet<F, C, Skip>(packet, f);
+                            for (int l = 0; l < lanes; ++l)
+                                target(columns[l], y) = pack_gray(packet.composite[l].result());
+                        }
+                }
+            });
+        }
+    };
+
+    template <typename T, typename Layout> using kernel_fn = void (*)(const frame<T, Layout>&);
+    template <typename T, typename Layout> inline constexpr auto dispatch_table = make_dispatch_table<kernel_fn<T, Layout>, kernels<T, Layout>>();
+} // namespace cpu_ray_marcher_detail
+
+// 无需 OpenGL 上下文的 CPU 光线步进, 体数据位于 [-0.5, 0.5] 的立方体内
+// target 的尺寸即视口尺寸, 第 0 行位于底部 (与 OpenGL 帧缓冲一致), 像素按 RGBA8 打包
+// 图像按块分配到所有核心, 每行 8 条光线组成一个包以 SoA 方式步进
+// 插值, 合成方式和是否跳过空单元在调用时查表选择一次, 每种组合都是独立实例化的内核
+template <typename T, typename Layout>
+static inline void cpu_ray_march(const camera_info& cam, volume_view<const T, Layout> vol, pixel<uint32_t>& target, const cpu_ray_march_options<T>& options = {})
+{
+    if (target.size.x <= 0 || target.size.y <= 0)
+        return;
+    if (vol.memory.empty())
+    {
+        std::fill(target.memory.begin(), target.memory.end(), options.background);
+        return;
+    }
+    using namespace cpu_ray_marcher_detail;
+    auto kernel = dispatch_table<T, Layout>[static_cast<size_t>(options.filter)][static_cast<size_t>(options.composite)][options.cells != nullptr];
+    kernel(frame<T, Layout>{ cam, vol, target, options });
+}
+template <typename T, typename Layout>
+static inline void cpu_ray_march(const camera_info& cam, const voxel<T, Layout>& vol, pixel<uint32_t>& target, const cpu_ray_march_options<T>& options = {})
+{
+    cpu_ray_march(cam, as_view(vol), target, options);
+}
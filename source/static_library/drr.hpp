@@ -0,0 +1,160 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "interface/pixel.hpp"
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+// DRR 几何, 所有坐标为世界坐标 (与 voxel_spacing 同单位)
+// 体素 (x, y, z) 占据 volume_origin + [x, x + 1) * voxel_spacing 的范围
+// 锥束: 射线从 source 射向每个探测器像素中心; 平行束: 射线沿 direction 穿过像素中心所在直线
+struct drr_geometry
+{
+    glm::vec3 volume_origin{ 0.0f };
+    glm::vec3 voxel_spacing{ 1.0f };
+
+    glm::vec3 source{ 0.0f };
+    bool parallel_beam = false;
+    glm::vec3 direction{ 0.0f, 0.0f, 1.0f }; // 仅平行束使用
+
+    glm::ivec2 detector_size{ 0 };
+    glm::vec3 detector_origin{ 0.0f };         // 像素 (0, 0) 的中心
+    glm::vec3 detector_u{ 1.0f, 0.0f, 0.0f }; // 相邻列之间的位移
+    glm::vec3 detector_v{ 0.0f, 1.0f, 0.0f }; // 相邻行之间的位移
+
+    glm::vec3 pixel_center(int u, int v) const { return detector_origin + detector_u * static_cast<float>(u) + detector_v * static_cast<float>(v); }
+};
+
+// 绕体数据中心在 x-z 平面内旋转 angle (弧度) 的锥束几何, 探测器与中心轴垂直, 行方向为 +y
+static inline drr_geometry make_circular_drr_geometry(glm::ivec3 size, glm::vec3 spacing, float angle, float source_distance, float detector_distance, glm::ivec2 detector_size,
+                                                      glm::vec2 pixel_pitch)
+{
+    drr_geometry geo;
+    geo.voxel_spacing = spacing;
+    glm::vec3 extent = glm::vec3(size) * spacing;
+    geo.volume_origin = -extent * 0.5f;
+
+    glm::vec3 axis = { std::sin(angle), 0.0f, std::cos(angle) }; // 从中心指向射线源
+    glm::vec3 u = glm::normalize(glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), axis));
+    glm::vec3 v = { 0.0f, 1.0f, 0.0f };
+    geo.source = axis * source_distance;
+    geo.detector_size = detector_size;
+    geo.detector_u = u * pixel_pitch.x;
+    geo.detector_v = v * pixel_pitch.y;
+    glm::vec3 detector_center = -axis * detector_distance;
+    geo.detector_origin = detector_center - geo.detector_u * (static_cast<float>(detector_size.x - 1) * 0.5f) - geo.detector_v * (static_cast<float>(detector_size.y - 1) * 0.5f);
+    return geo;
+}
+
+namespace drr_detail
+{
+    // Amanatides-Woo 体素遍历, 每个体素只访问一次, 累加 穿过长度 * 值
+    // origin, direction 为世界坐标, direction 已归一化, 只统计 [t_min, t_max] 内的部分
+    template <typename T> static inline double line_integral(volume_view<const T> vol, const drr_geometry& geo, glm::vec3 origin, glm::vec3 direction, float t_min, float t_max)
+    {
+        glm::vec3 p = (origin - geo.volume_origin) / geo.voxel_spacing; // 体素坐标
+        glm::vec3 d = direction / geo.voxel_spacing;                    // 每单位世界长度在体素坐标中的位移
+        glm::vec3 size = glm::vec3(vol.size);
+
+        // 与体数据包围盒求交
+        float t0 = t_min, t1 = t_max;
+        for (int k = 0; k < 3; ++k)
+        {
+            if (std::abs(d[k]) < 1e-12f)
+            {
+                if (p[k] < 0.0f || p[k] >= size[k])
+                    return 0.0;
+                continue;
+            }
+            float a = (0.0f - p[k]) / d[k];
+            float b = (size[k] - p[k]) / d[k];
+            t0 = std::max(t0, std::min(a, b));
+            t1 = std::min(t1, std::max(a, b));
+        }
+        if (t0 >= t1)
+            return 0.0;
+
+        // 进入点恰好落在边界上时按舍入结果钳制到体数据内
+        glm::vec3 entry = p + d * t0;
+        glm::ivec3 voxel;
+        glm::ivec3 step;
+        glm::vec3 t_next, t_delta;
+        for (int k = 0; k < 3; ++k)
+        {
+            voxel[k] = std::clamp(static_cast<int>(std::floor(entry[k])), 0, vol.size[k] - 1);
+            if (d[k] > 0.0f)
+            {
+                step[k] = 1;
+                t_delta[k] = 1.0f / d[k];
+                t_next[k] = t0 + (static_cast<float>(voxel[k] + 1) - entry[k]) / d[k];
+            }
+            else if (d[k] < 0.0f)
+            {
+                step[k] = -1;
+                t_delta[k] = -1.0f / d[k];
+                t_next[k] = t0 + (static_cast<float>(voxel[k]) - entry[k]) / d[k];
+            }
+            else
+            {
+                step[k] = 0;
+                t_delta[k] = std::numeric_limits<float>::infinity();
+                t_next[k] = std::numeric_limits<float>::infinity();
+            }
+        }
+
+        double sum = 0.0;
+        float t = t0;
+        while (t < t1)
+        {
+            int k = t_next.x < t_next.y ? (t_next.x < t_next.z ? 0 : 2) : (t_next.y < t_next.z ? 1 : 2);
+            float t_end = std::min(t_next[k], t1);
+            sum += static_cast<double>(t_end - t) * static_cast<double>(vol(voxel.x, voxel.y, voxel.z));
+            t = t_end;
+            voxel[k] += step[k];
+            if (voxel[k] < 0 || voxel[k] >= vol.size[k])
+                break;
+            t_next[k] += t_delta[k];
+        }
+        return sum;
+    }
+} // namespace drr_detail
+
+// 生成 DRR: 每个探测器像素为射线穿过体数据的线积分 sum(长度 * 值) * value_scale
+// 透射强度为 exp(-结果), 由调用方按需要转换; 探测器行在线程间动态分配
+template <typename T> static inline pixel<float> render_drr(volume_view<const T> vol, const drr_geometry& geo, float value_scale = 1.0f)
+{
+    pixel<float> out = make_pixel<float>(geo.detector_size);
+    if (out.memory.empty())
+        return out;
+    constexpr float infinity = std::numeric_limits<float>::infinity();
+    parallel_for(0, static_cast<size_t>(geo.detector_size.y), 4, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+        {
+            int v = static_cast<int>(row);
+            for (int u = 0; u < geo.detector_size.x; ++u)
+            {
+                glm::vec3 target = geo.pixel_center(u, v);
+                double sum = 0.0;
+                if (geo.parallel_beam)
+                    sum = drr_detail::line_integral(vol, geo, target, glm::normalize(geo.direction), -infinity, infinity);
+                else
+                {
+                    glm::vec3 ray = target - geo.source;
+                    float length = glm::length(ray);
+                    if (length > 0.0f)
+                        sum = drr_detail::line_integral(vol, geo, geo.source, ray / length, 0.0f, length);
+                }
+                out(u, v) = static_cast<float>(sum) * value_scale;
+            }
+        }
+    });
+    return out;
+}
+template <typename T> static inline pixel<float> render_drr(const voxel<T>& vol, const drr_geometry& geo, float value_scale = 1.0f)
+{
+    return render_drr(as_view(vol), geo, value_scale);
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+// 预计算的梯度体, 每体素 4 字节 (RGBA8_SNORM): xyz 为梯度向量本身, w 为梯度模长, 均按 magnitude_scale 量化到 [-127, 127]
+// 存的是向量而不是单位法线, 硬件三线性插值的结果仍是插值后的梯度, 着色器一次 texture() 后归一化即得法线
+// 着色时代替每个采样点 6 次中心差分采样; 方向为值增大的方向
+struct gradient_volume
+{
+    float magnitude_scale = 1.0f;
+    voxel<glm::vec<4, int8_t>> packed;
+};
+
+namespace gradient_volume_detail
+{
+    static inline uint8_t quantize_snorm(float v)
+    {
+        return static_cast<uint8_t>(std::clamp(v * 127.5f + 127.5f + 0.5f, 0.0f, 255.0f));
+    }
+
+    static inline int8_t quantize_signed(float v)
+    {
+        return static_cast<int8_t>(std::clamp(std::round(v), -127.0f, 127.0f));
+    }
+
+    // 八面体编码: 投影到 |x| + |y| + |z| = 1, 下半球沿对角线翻折到外侧; 用于等值面网格的顶点法线, 编码不能线性插值
+    static inline glm::vec<2, uint8_t> encode_octahedral(glm::vec3 n)
+    {
+        float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        if (l1 <= 0.0f)
+            return { 128, 128 };
+        glm::vec2 p = glm::vec2(n.x, n.y) / l1;
+        if (n.z < 0.0f)
+        {
+            glm::vec2 s = { p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f };
+            p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * s;
+        }
+        return { quantize_snorm(p.x), quantize_snorm(p.y) };
+    }
+
+    // 第 (y, z) 行的中心差分, 边界处退化为单侧差分
+    template <typename Func> static inline void row_gradient(volume_view<const uint16_t> vol, int y, int z, std::vector<glm::vec3>& out, Func&& func)
+    {
+        glm::ivec3 size = vol.size;
+        int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, size.y - 1);
+        int z0 = std::max(z - 1, 0), z1 = std::min(z + 1, size.z - 1);
+        const uint16_t* row = &vol(0, y, z);
+        const uint16_t* ym = &vol(0, y0, z);
+        const uint16_t* yp = &vol(0, y1, z);
+        const uint16_t* zm = &vol(0, y, z0);
+        const uint16_t* zp = &vol(0, y, z1);
+        float sy = y1 > y0 ? 1.0f / static_cast<float>(y1 - y0) : 0.0f;
+        float sz = z1 > z0 ? 1.0f / static_cast<float>(z1 - z0) : 0.0f;
+        out.resize(size.x);
+        for (int x = 0; x < size.x; ++x)
+        {
+            out[x].y = (static_cast<float>(yp[x]) - static_cast<float>(ym[x])) * sy;
+            out[x].z = (static_cast<float>(zp[x]) - static_cast<float>(zm[x])) * sz;
+        }
+        if (size.x == 1)
+            out[0].x = 0.0f;
+        else
+        {
+            out[0].x = static_cast<float>(row[1]) - static_cast<float>(row[0]);
+            out[size.x - 1].x = static_cast<float>(row[size.x - 1]) - static_cast<float>(row[size.x - 2]);
+            for (int x = 1; x < size.x - 1; ++x)
+                out[x].x = (static_cast<float>(row[x + 1]) - static_cast<float>(row[x - 1])) * 0.5f;
+        }
+        func(out);
+    }
+} // namespace gradient_volume_detail
+
+// max_magnitude <= 0 时先并行扫描一遍求最大梯度模长, 使量化范围覆盖整个体
+static inline gradient_volume build_gradient_volume(volume_view<const uint16_t> vol, float max_magnitude = 0.0f)
+{
+    using namespace gradient_volume_detail;
+    gradient_volume result;
+    glm::ivec3 size = vol.size;
+    result.packed = make_voxel<glm::vec<4, int8_t>>(size);
+    if (result.packed.memory.empty())
+        return result;
+    size_t rows = static_cast<size_t>(size.y) * size.z;
+
+    if (max_magnitude <= 0.0f)
+    {
+        std::vector<float> partial(parallel_worker_count(), 0.0f);
+        parallel_for_workers(0, rows, 16, [&](size_t worker, size_t begin, size_t end) {
+            std::vector<glm::vec3> gradient;
+            for (size_t row = begin; row < end; ++row)
+                row_gradient(vol, static_cast<int>(row % size.y), static_cast<int>(row / size.y), gradient, [&](const std::vector<glm::vec3>& g) {
+                    float hi = partial[worker];
+                    for (const auto& v : g)
+                        hi = std::max(hi, glm::dot(v, v));
+                    partial[worker] = hi;
+                });
+        });
+        max_magnitude = std::sqrt(*std::max_element(partial.begin(), partial.end()));
+    }
+    result.magnitude_scale = max_magnitude > 0.0f ? 127.0f / max_magnitude : 0.0f;
+
+    parallel_for(0, rows, 16, [&](size_t begin, size_t end) {
+        std::vector<glm::vec3> gradient;
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = static_cast<int>(row % size.y);
+            int z = static_cast<int>(row / size.y);
+            row_gradient(vol, y, z, gradient, [&](const std::vector<glm::vec3>& g) {
+                auto* out = &result.packed(0, y, z);
+                for (int x = 0; x < size.x; ++x)
+                {
+                    glm::vec3 v = g[x] * result.magnitude_scale;
+                    out[x] = { quantize_signed(v.x), quantize_signed(v.y), quantize_signed(v.z), quantize_signed(glm::length(v)) };
+                }
+            });
+        }
+    });
+    return result;
+}
+static inline gradient_volume build_gradient_volume(const voxel<uint16_t>& vol, float max_magnitude = 0.0f)
+{
+    return build_gradient_volume(as_view(vol), max_magnitude);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// 按 Alignment 字节对齐的分配器, 无参构造时只做默认初始化 (不清零)
+// 配合 std::vector 使用, resize 后由调用方直接覆盖写入, 避免大体数据先清零再拷贝的双重写入
+template <typename T, size_t Alignment = 64> struct aligned_allocator
+{
+    using value_type = T;
+    static constexpr std::align_val_t alignment{ std::max(Alignment, alignof(T)) };
+
+    template <typename U> struct rebind
+    {
+        using other = aligned_allocator<U, Alignment>;
+    };
+
+    aligned_allocator() noexcept = default;
+    template <typename U> aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n) { return static_cast<T*>(::operator new(n * sizeof(T), alignment)); }
+    void deallocate(T* p, size_t) noexcept { ::operator delete(p, alignment); }
+
+    template <typename U> void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) { ::new (static_cast<void*>(p)) U; }
+    template <typename U, typename... Args> void construct(U* p, Args&&... args) { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); }
+
+    template <typename U> friend bool operator==(const aligned_allocator&, const aligned_allocator<U, Alignment>&) noexcept { return true; }
+};
+
+template <typename T> using aligned_buffer = std::vector<T, aligned_allocator<T>>;
@@ -0,0 +1,138 @@
+#pragma once
+#include <bit>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/aligned_buffer.hpp"
+#include "interface/voxel.hpp"
+
+// 分块体素: 体数据被切成 N*N*N 的砖块, 每个砖块在内存中连续存放
+// 砖块之间按 z, y, x 顺序排列, 砖块内部同样按 z, y, x 排列
+// 边缘不足 N 的砖块使用 T{} 填充
+template <typename T, int N = 16> struct bricked_voxel
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "brick size must be a power of two");
+
+    static constexpr int brick_size = N;
+    static constexpr int brick_shift = std::countr_zero(static_cast<unsigned>(N));
+    static constexpr int brick_mask = N - 1;
+    static constexpr size_t brick_volume = static_cast<size_t>(N) * N * N;
+
+    template <typename U> struct basic_brick
+    {
+        glm::ivec3 coord;                  // 砖块索引
+        glm::ivec3 origin;                 // 砖块第一个体素在体数据中的坐标
+        std::span<U, brick_volume> memory; // layout: z, y, x
+
+        U& operator()(int x, int y, int z) const { return memory[(static_cast<size_t>(z) * N + y) * N + x]; }
+        // 砖块内实际有效的体素范围 (边缘砖块小于 N)
+        glm::ivec3 extent(glm::ivec3 size) const { return glm::min(glm::ivec3(N), size - origin); }
+    };
+    using brick = basic_brick<T>;
+    using const_brick = basic_brick<const T>;
+
+    glm::ivec3 size;   // 体素数量
+    glm::ivec3 bricks; // 砖块数量
+    aligned_buffer<T> memory;
+
+    T& operator()(int x, int y, int z) { return memory[index_of(x, y, z)]; }
+    const T& operator()(int x, int y, int z) const { return memory[index_of(x, y, z)]; }
+
+    size_t index_of(int x, int y, int z) const
+    {
+        size_t b = brick_index(x >> brick_shift, y >> brick_shift, z >> brick_shift);
+        size_t local = (static_cast<size_t>(z & brick_mask) * N + (y & brick_mask)) * N + (x & brick_mask);
+        return b * brick_volume + local;
+    }
+    size_t brick_index(int bx, int by, int bz) const { return (static_cast<size_t>(bz) * bricks.y + by) * bricks.x + bx; }
+    size_t brick_count() const { return static_cast<size_t>(bricks.x) * bricks.y * bricks.z; }
+
+    brick brick_at(size_t index) { return make_brick<T>(memory.data(), index); }
+    const_brick brick_at(size_t index) const { return make_brick<const T>(memory.data(), index); }
+    brick brick_at(int bx, int by, int bz) { return brick_at(brick_index(bx, by, bz)); }
+    const_brick brick_at(int bx, int by, int bz) const { return brick_at(brick_index(bx, by, bz)); }
+
+    // 按内存顺序遍历所有砖块, func(brick)
+    template <typename Func> void for_each_brick(Func&& func)
+    {
+        for (size_t i = 0; i < brick_count(); ++i)
+            func(brick_at(i));
+    }
+    template <typename Func> void for_each_brick(Func&& func) const
+    {
+        for (size_t i = 0; i < brick_count(); ++i)
+            func(brick_at(i));
+    }
+
+    // 写回连续的 z, y, x 缓冲区, 可直接交给 texture_from
+    void copy_to(std::span<T> target) const
+    {
+        for_each_brick([&](const_brick b) {
+            glm::ivec3 ext = b.extent(size);
+            for (int z = 0; z < ext.z; ++z)
+                for (int y = 0; y < ext.y; ++y)
+                {
+                    size_t dst = (static_cast<size_t>(b.origin.z + z) * size.y + (b.origin.y + y)) * size.x + b.origin.x;
+                    if (dst + ext.x > target.size())
+                        return;
+                    std::copy_n(&b(0, y, z), ext.x, target.data() + dst);
+                }
+        });
+    }
+    // 从连续的 z, y, x 缓冲区读入
+    void copy_from(std::span<const T> source)
+    {
+        for_each_brick([&](brick b) {
+            glm::ivec3 ext = b.extent(size);
+            for (int z = 0; z < ext.z; ++z)
+                for (int y = 0; y < ext.y; ++y)
+                {
+                    size_t src = (static_cast<size_t>(b.origin.z + z) * size.y + (b.origin.y + y)) * size.x + b.origin.x;
+                    if (src + ext.x > source.size())
+                        return;
+                    std::copy_n(source.data() + src, ext.x, &b(0, y, z));
+                }
+        });
+    }
+
+private:
+    template <typename U, typename P> basic_brick<U> make_brick(P* base, size_t index) const
+    {
+        glm::ivec3 coord;
+        coord.x = static_cast<int>(index % bricks.x);
+        coord.y = static_cast<int>(index / bricks.x % bricks.y);
+        coord.z = static_cast<int>(index / bricks.x / bricks.y);
+        return { coord, coord * N, std::span<U, brick_volume>(base + index * brick_volume, brick_volume) };
+    }
+};
+
+template <typename T, int N = 16> static inline bricked_voxel<T, N> make_bricked_voxel(glm::ivec3 size)
+{
+    bricked_voxel<T, N> vox;
+    vox.size = size;
+    vox.bricks = (size + glm::ivec3(N - 1)) / N;
+    vox.memory.assign(vox.brick_count() * vox.brick_volume, T{});
+    return vox;
+}
+
+// 从 z, y, x 排列的连续数据构建, 供加载器直接填充
+template <typename T, int N = 16> static inline bricked_voxel<T, N> make_bricked_voxel(glm::ivec3 size, std::span<const T> source)
+{
+    bricked_voxel<T, N> vox = make_bricked_voxel<T, N>(size);
+    vox.copy_from(source);
+    return vox;
+}
+
+template <typename T, int N = 16> static inline bricked_voxel<T, N> make_bricked_voxel(const voxel<T>& vol)
+{
+    return make_bricked_voxel<T, N>(vol.size, std::span<const T>(vol.memory));
+}
+
+template <typename T, int N> static inline voxel<T> to_voxel(const bricked_voxel<T, N>& bricked)
+{
+    voxel<T> vox = make_voxel<T>(bricked.size);
+    bricked.copy_to(vox.memory);
+    return vox;
+}
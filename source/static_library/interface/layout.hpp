@@ -0,0 +1,193 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <mdspan>
+
+// 自定义 mdspan 布局策略, 索引顺序与 std::layout_right 一致: 3 维为 z, y, x, 2 维为 y, x
+// 只改变内存排列, voxel/pixel 的 operator()(x, y, z) 语义不变
+// 经布局策略直接读取邻域的内核只有 cpu_ray_march (插值的 8 个角点); texture_from / project_axis / classify_materials 的 Layout 重载只是先 relayout 回 layout_right 再计算
+
+namespace layout_detail
+{
+    // 把低 21 位展开到每 3 位一位
+    constexpr uint64_t spread_bits_3(uint64_t v)
+    {
+        v &= 0x1fffff;
+        v = (v | v << 32) & 0x1f00000000ffff;
+        v = (v | v << 16) & 0x1f0000ff0000ff;
+        v = (v | v << 8) & 0x100f00f00f00f00f;
+        v = (v | v << 4) & 0x10c30c30c30c30c3;
+        v = (v | v << 2) & 0x1249249249249249;
+        return v;
+    }
+    // 把低 32 位展开到每 2 位一位
+    constexpr uint64_t spread_bits_2(uint64_t v)
+    {
+        v &= 0xffffffff;
+        v = (v | v << 16) & 0x0000ffff0000ffff;
+        v = (v | v << 8) & 0x00ff00ff00ff00ff;
+        v = (v | v << 4) & 0x0f0f0f0f0f0f0f0f;
+        v = (v | v << 2) & 0x3333333333333333;
+        v = (v | v << 1) & 0x5555555555555555;
+        return v;
+    }
+    constexpr uint64_t morton_encode(uint64_t x, uint64_t y)
+    {
+        return spread_bits_2(x) | spread_bits_2(y) << 1;
+    }
+    constexpr uint64_t morton_encode(uint64_t x, uint64_t y, uint64_t z)
+    {
+        return spread_bits_3(x) | spread_bits_3(y) << 1 | spread_bits_3(z) << 2;
+    }
+} // namespace layout_detail
+
+// Z-order (Morton) 布局, 相邻体素在三个方向上都保持局部性
+// 索引是各轴坐标的位交错, 等价于把每个轴补齐到 2 的幂再按最长轴补成立方体: 尺寸不是 2 的幂或各轴差别较大时,
+// 所需内存大于体素数量 (例如 1024 x 1024 x 1025 需要 2048^3 个元素, 各轴补齐本身最多浪费 8 倍)
+// 3 维时每轴最多 2^21 个体素; 跨度很容易超过 int, 所以 voxel / pixel 对该布局使用 64 位索引 (见 layout_index_t)
+struct layout_morton
+{
+    template <typename Extents> class mapping
+    {
+        static_assert(Extents::rank() == 2 || Extents::rank() == 3, "layout_morton supports rank 2 and 3 only");
+
+    public:
+        using extents_type = Extents;
+        using index_type = typename Extents::index_type;
+        using size_type = typename Extents::size_type;
+        using rank_type = typename Extents::rank_type;
+        using layout_type = layout_morton;
+
+        constexpr mapping() noexcept = default;
+        constexpr mapping(const extents_type& e) noexcept : ext(e) {}
+
+        constexpr const extents_type& extents() const noexcept { return ext; }
+
+        constexpr index_type required_span_size() const noexcept
+        {
+            for (rank_type r = 0; r < extents_type::rank(); ++r)
+                if (ext.extent(r) == 0)
+                    return 0;
+            // Morton 编码在每个轴上单调, 最大索引在最后一个体素处
+            if constexpr (extents_type::rank() == 3)
+                return static_cast<index_type>(layout_detail::morton_encode(ext.extent(2) - 1, ext.extent(1) - 1, ext.extent(0) - 1) + 1);
+            else
+                return static_cast<index_type>(layout_detail::morton_encode(ext.extent(1) - 1, ext.extent(0) - 1) + 1);
+        }
+
+        template <typename... Indices> constexpr index_type operator()(Indices... idx) const noexcept
+        {
+            static_assert(sizeof...(Indices) == extents_type::rank());
+            if constexpr (extents_type::rank() == 3)
+            {
+                auto [z, y, x] = std::array<uint64_t, 3>{ static_cast<uint64_t>(idx)... };
+                return static_cast<index_type>(layout_detail::morton_encode(x, y, z));
+            }
+            else
+            {
+                auto [y, x] = std::array<uint64_t, 2>{ static_cast<uint64_t>(idx)... };
+                return static_cast<index_type>(layout_detail::morton_encode(x, y));
+            }
+        }
+
+        static constexpr bool is_always_unique() noexcept { return true; }
+        static constexpr bool is_always_exhaustive() noexcept { return false; }
+        static constexpr bool is_always_strided() noexcept { return false; }
+        static constexpr bool is_unique() noexcept { return true; }
+        constexpr bool is_exhaustive() const noexcept { return false; }
+        static constexpr bool is_strided() noexcept { return false; }
+
+        friend constexpr bool operator==(const mapping& lhs, const mapping& rhs) noexcept { return lhs.ext == rhs.ext; }
+
+    private:
+        extents_type ext{};
+    };
+};
+
+// voxel / pixel / volume_view 中 mdspan 的索引类型, 只有 Morton 布局使用 64 位
+template <typename Layout> struct layout_index
+{
+    using type = int;
+};
+template <> struct layout_index<layout_morton>
+{
+    using type = int64_t;
+};
+template <typename Layout> using layout_index_t = typename layout_index<Layout>::type;
+
+// 分块布局: 体数据切成 Tx*Ty*Tz 的小块, 块内与块间均为 z, y, x 顺序
+// 2 维时忽略 Tz
+template <int Tx, int Ty, int Tz = 1> struct layout_tiled
+{
+    static_assert(Tx > 0 && Ty > 0 && Tz > 0, "tile size must be positive");
+
+    template <typename Extents> class mapping
+    {
+        static_assert(Extents::rank() == 2 || Extents::rank() == 3, "layout_tiled supports rank 2 and 3 only");
+        static constexpr bool is_3d = Extents::rank() == 3;
+
+    public:
+        using extents_type = Extents;
+        using index_type = typename Extents::index_type;
+        using size_type = typename Extents::size_type;
+        using rank_type = typename Extents::rank_type;
+        using layout_type = layout_tiled;
+
+        static constexpr index_type tile_volume = is_3d ? Tx * Ty * Tz : Tx * Ty;
+
+        constexpr mapping() noexcept = default;
+        constexpr mapping(const extents_type& e) noexcept : ext(e)
+        {
+            tiles_x = (ext.extent(extents_type::rank() - 1) + Tx - 1) / Tx;
+            tiles_y = (ext.extent(extents_type::rank() - 2) + Ty - 1) / Ty;
+            if constexpr (is_3d)
+                tiles_z = (ext.extent(0) + Tz - 1) / Tz;
+        }
+
+        constexpr const extents_type& extents() const noexcept { return ext; }
+
+        constexpr index_type required_span_size() const noexcept { return tiles_x * tiles_y * tiles_z * tile_volume; }
+
+        template <typename... Indices> constexpr index_type operator()(Indices... idx) const noexcept
+        {
+            static_assert(sizeof...(Indices) == extents_type::rank());
+            if constexpr (is_3d)
+            {
+                auto [z, y, x] = std::array<index_type, 3>{ static_cast<index_type>(idx)... };
+                index_type tile = ((z / Tz) * tiles_y + (y / Ty)) * tiles_x + (x / Tx);
+                index_type local = ((z % Tz) * Ty + (y % Ty)) * Tx + (x % Tx);
+                return tile * tile_volume + local;
+            }
+            else
+            {
+                auto [y, x] = std::array<index_type, 2>{ static_cast<index_type>(idx)... };
+                index_type tile = (y / Ty) * tiles_x + (x / Tx);
+                index_type local = (y % Ty) * Tx + (x % Tx);
+                return tile * tile_volume + local;
+            }
+        }
+
+        static constexpr bool is_always_unique() noexcept { return true; }
+        static constexpr bool is_always_exhaustive() noexcept { return false; }
+        static constexpr bool is_always_strided() noexcept { return false; }
+        static constexpr bool is_unique() noexcept { return true; }
+        constexpr bool is_exhaustive() const noexcept { return required_span_size() == static_cast<index_type>(ext_size()); }
+        static constexpr bool is_strided() noexcept { return false; }
+
+        friend constexpr bool operator==(const mapping& lhs, const mapping& rhs) noexcept { return lhs.ext == rhs.ext; }
+
+    private:
+        constexpr size_t ext_size() const noexcept
+        {
+            size_t s = 1;
+            for (rank_type r = 0; r < extents_type::rank(); ++r)
+                s *= ext.extent(r);
+            return s;
+        }
+
+        extents_type ext{};
+        index_type tiles_x = 0;
+        index_type tiles_y = 0;
+        index_type tiles_z = 1;
+    };
+};
@@ -1,33 +1,114 @@
 #pragma once
 #include <mdspan>
+#include <span>
 #include <vector>
 
 #include <glm/glm.hpp>
 
-template <typename T> struct pixel
+#include "interface/aligned_buffer.hpp"
+#include "interface/layout.hpp"
+
+// 持有内存的二维图像, memory 按 64 字节对齐, 拷贝和移动都会让 view 指向自身的 memory
+// Layout 为 mdspan 布局策略: std::layout_right (默认), layout_morton, layout_tiled<Tx, Ty>
+template <typename T, typename Layout = std::layout_right> struct pixel
 {
-    glm::ivec2 size;
-    std::vector<T> memory;
-    std::mdspan<T, std::dextents<int, 2>> view; // layout: y, x
+    using layout_type = Layout;
+    using memory_type = aligned_buffer<T>;
+    using view_type = std::mdspan<T, std::dextents<layout_index_t<Layout>, 2>, Layout>;
+
+    glm::ivec2 size{ 0 };
+    memory_type memory;
+    view_type view; // index: y, x
+
+    pixel() = default;
+    // 分配但不初始化内存
+    explicit pixel(glm::ivec2 size) : size(size), memory(required_size(size)) { rebind(); }
+    // 接管已有缓冲区, 不足的部分补零
+    pixel(glm::ivec2 size, memory_type&& buffer) : size(size), memory(std::move(buffer))
+    {
+        memory.resize(required_size(size), T{});
+        rebind();
+    }
+    pixel(const pixel& other) : size(other.size), memory(other.memory) { rebind(); }
+    pixel(pixel&& other) noexcept : size(other.size), memory(std::move(other.memory))
+    {
+        rebind();
+        other.reset();
+    }
+    pixel& operator=(const pixel& other)
+    {
+        if (this != &other)
+        {
+            size = other.size;
+            memory = other.memory;
+            rebind();
+        }
+        return *this;
+    }
+    pixel& operator=(pixel&& other) noexcept
+    {
+        if (this != &other)
+        {
+            size = other.size;
+            memory = std::move(other.memory);
+            rebind();
+            other.reset();
+        }
+        return *this;
+    }
 
     T& operator()(int x, int y) { return view[y, x]; }
+    const T& operator()(int x, int y) const { return view[y, x]; }
+
+    static typename view_type::mapping_type make_mapping(glm::ivec2 size) { return typename view_type::mapping_type(typename view_type::extents_type(size.y, size.x)); }
+    static size_t required_size(glm::ivec2 size) { return static_cast<size_t>(make_mapping(size).required_span_size()); }
+
+private:
+    void rebind() { view = view_type(memory.data(), make_mapping(size)); }
+    void reset()
+    {
+        size = glm::ivec2(0);
+        memory.clear();
+        rebind();
+    }
 };
 
-template <typename T> static inline pixel<T> make_pixel(glm::ivec2 size)
+// 内存未初始化, 由调用方填充
+template <typename T, typename Layout = std::layout_right> static inline pixel<T, Layout> make_pixel(glm::ivec2 size)
 {
-    pixel<T> pix;
-    pix.size = size;
-    pix.memory.resize(size.x * size.y);
-    pix.view = std::mdspan<T, std::dextents<int, 2>>(pix.memory.data(), size.y, size.x);
+    return pixel<T, Layout>(size);
+}
+// 接管已有缓冲区, 不发生拷贝
+template <typename T, typename Layout = std::layout_right> static inline pixel<T, Layout> make_pixel(glm::ivec2 size, aligned_buffer<T>&& buffer)
+{
+    return pixel<T, Layout>(size, std::move(buffer));
+}
+// source 按 y, x 连续排列, 只写入一次
+template <typename T, typename Layout = std::layout_right> static inline pixel<T, Layout> make_pixel(glm::ivec2 size, std::span<const T> source)
+{
+    pixel<T, Layout> pix(size);
+    if constexpr (std::is_same_v<Layout, std::layout_right>)
+    {
+        size_t copy_size = std::min(source.size(), pix.memory.size());
+        std::copy_n(source.data(), copy_size, pix.memory.data());
+        std::fill(pix.memory.begin() + copy_size, pix.memory.end(), T{});
+    }
+    else
+    {
+        std::fill(pix.memory.begin(), pix.memory.end(), T{});
+        size_t index = 0;
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x && index < source.size(); ++x)
+                pix(x, y) = source[index++];
+    }
     return pix;
 }
-template <typename T> static inline pixel<T> make_pixel(glm::ivec2 size, std::span<T> source)
+
+template <typename To, typename T, typename From> static inline pixel<T, To> relayout(const pixel<T, From>& source)
 {
-    pixel<T> pix;
-    pix.size = size;
-    pix.memory.resize(size.x * size.y);
-    pix.view = std::mdspan<T, std::dextents<int, 2>>(pix.memory.data(), size.y, size.x);
-    size_t copy_size = std::min(source.size(), pix.memory.size());
-    std::copy_n(source.data(), copy_size, pix.memory.data());
+    pixel<T, To> pix(source.size);
+    for (int y = 0; y < source.size.y; ++y)
+        for (int x = 0; x < source.size.x; ++x)
+            pix(x, y) = source(x, y);
     return pix;
 }
@@ -0,0 +1,33 @@
+#pragma once
+#include <mdspan>
+#include <span>
+
+#include <glm/glm.hpp>
+
+#include "interface/layout.hpp"
+
+// 不持有内存的体数据视图, 成员与 voxel 保持一致 (size, memory, view), 按值传递
+// 只读视图使用 volume_view<const T>
+template <typename T, typename Layout = std::layout_right> struct volume_view
+{
+    using value_type = std::remove_const_t<T>;
+    using layout_type = Layout;
+    using view_type = std::mdspan<T, std::dextents<layout_index_t<Layout>, 3>, Layout>;
+
+    glm::ivec3 size{ 0 };
+    std::span<T> memory;
+    view_type view; // index: z, y, x
+
+    volume_view() = default;
+    volume_view(glm::ivec3 size, std::span<T> memory) : size(size), memory(memory), view(memory.data(), make_mapping(size)) {}
+    // 可写视图可隐式转换为只读视图
+    template <typename U>
+        requires(std::is_same_v<const U, T> && !std::is_same_v<U, T>)
+    volume_view(const volume_view<U, Layout>& other) : volume_view(other.size, std::span<T>(other.memory))
+    {
+    }
+
+    T& operator()(int x, int y, int z) const { return view[z, y, x]; }
+
+    static typename view_type::mapping_type make_mapping(glm::ivec3 size) { return typename view_type::mapping_type(typename view_type::extents_type(size.z, size.y, size.x)); }
+};
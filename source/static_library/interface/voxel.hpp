@@ -5,52 +5,137 @@
 
 #include <glm/glm.hpp>
 
-template <typename T> struct voxel
+#include "interface/aligned_buffer.hpp"
+#include "interface/layout.hpp"
+#include "interface/volume_view.hpp"
+
+// 持有内存的体数据, memory 按 64 字节对齐
+// 拷贝和移动都会让 view 指向自身的 memory, 需要传递时优先使用 volume_view
+// Layout 为 mdspan 布局策略: std::layout_right (默认), layout_morton, layout_tiled<Tx, Ty, Tz>
+template <typename T, typename Layout = std::layout_right> struct voxel
 {
-    glm::ivec3 size;
-    std::vector<T> memory;
-    std::mdspan<T, std::dextents<int, 3>> view; // layout: z, y, x
+    using layout_type = Layout;
+    using memory_type = aligned_buffer<T>;
+    using view_type = std::mdspan<T, std::dextents<layout_index_t<Layout>, 3>, Layout>;
+
+    glm::ivec3 size{ 0 };
+    memory_type memory;
+    view_type view; // index: z, y, x
+
+    voxel() = default;
+    // 分配但不初始化内存
+    explicit voxel(glm::ivec3 size) : size(size), memory(required_size(size)) { rebind(); }
+    // 接管已有缓冲区, 不足的部分补零
+    voxel(glm::ivec3 size, memory_type&& buffer) : size(size), memory(std::move(buffer))
+    {
+        memory.resize(required_size(size), T{});
+        rebind();
+    }
+    voxel(const voxel& other) : size(other.size), memory(other.memory) { rebind(); }
+    voxel(voxel&& other) noexcept : size(other.size), memory(std::move(other.memory))
+    {
+        rebind();
+        other.reset();
+    }
+    voxel& operator=(const voxel& other)
+    {
+        if (this != &other)
+        {
+            size = other.size;
+            memory = other.memory;
+            rebind();
+        }
+        return *this;
+    }
+    voxel& operator=(voxel&& other) noexcept
+    {
+        if (this != &other)
+        {
+            size = other.size;
+            memory = std::move(other.memory);
+            rebind();
+            other.reset();
+        }
+        return *this;
+    }
 
     T& operator()(int x, int y, int z) { return view[z, y, x]; }
+    const T& operator()(int x, int y, int z) const { return view[z, y, x]; }
+
+    operator volume_view<T, Layout>() { return { size, std::span<T>(memory) }; }
+    operator volume_view<const T, Layout>() const { return { size, std::span<const T>(memory) }; }
+
+    static typename view_type::mapping_type make_mapping(glm::ivec3 size) { return typename view_type::mapping_type(typename view_type::extents_type(size.z, size.y, size.x)); }
+    static size_t required_size(glm::ivec3 size) { return static_cast<size_t>(make_mapping(size).required_span_size()); }
+
+private:
+    void rebind() { view = view_type(memory.data(), make_mapping(size)); }
+    void reset()
+    {
+        size = glm::ivec3(0);
+        memory.clear();
+        rebind();
+    }
 };
 
-template <typename T> static inline voxel<T> make_voxel(glm::ivec3 size)
+template <typename T, typename Layout> static inline volume_view<T, Layout> as_view(voxel<T, Layout>& vox)
 {
-    voxel<T> vox;
-    vox.size = size;
-    vox.memory.resize(size.x * size.y * size.z);
-    vox.view = std::mdspan<T, std::dextents<int, 3>>(vox.memory.data(), size.z, size.y, size.x);
     return vox;
 }
-
-template <typename T> static inline voxel<T> make_voxel(glm::ivec3 size, std::span<T> source)
+template <typename T, typename Layout> static inline volume_view<const T, Layout> as_view(const voxel<T, Layout>& vox)
 {
-    voxel<T> vox;
-    vox.size = size;
-    vox.memory.resize(size.x * size.y * size.z);
-    vox.view = std::mdspan<T, std::dextents<int, 3>>(vox.memory.data(), size.z, size.y, size.x);
-    size_t copy_size = std::min(source.size(), vox.memory.size());
-    std::copy_n(source.data(), copy_size, vox.memory.data());
     return vox;
 }
+template <typename T, typename Layout> static inline volume_view<T, Layout> as_view(volume_view<T, Layout> view)
+{
+    return view;
+}
+
+// 内存未初始化, 由调用方填充
+template <typename T, typename Layout = std::layout_right> static inline voxel<T, Layout> make_voxel(glm::ivec3 size)
+{
+    return voxel<T, Layout>(size);
+}
+
+// 接管加载器产生的缓冲区, 不发生拷贝
+template <typename T, typename Layout = std::layout_right> static inline voxel<T, Layout> make_voxel(glm::ivec3 size, aligned_buffer<T>&& buffer)
+{
+    return voxel<T, Layout>(size, std::move(buffer));
+}
 
-#include <cereal/cereal.hpp>
-template <typename Archive, typename T> void serialize(Archive& ar, voxel<T>& vox)
+// source 按 z, y, x 连续排列, 只写入一次
+template <typename T, typename Layout = std::layout_right> static inline voxel<T, Layout> make_voxel(glm::ivec3 size, std::span<const T> source)
 {
-    ar(typeid(T).hash_code());
-    ar(vox.size);
-    if (Archive::is_loading::value)
+    voxel<T, Layout> vox(size);
+    if constexpr (std::is_same_v<Layout, std::layout_right>)
+    {
+        size_t copy_size = std::min(source.size(), vox.memory.size());
+        std::copy_n(source.data(), copy_size, vox.memory.data());
+        std::fill(vox.memory.begin() + copy_size, vox.memory.end(), T{});
+    }
+    else
     {
-        vox.memory.resize(vox.size.x * vox.size.y * vox.size.z);
-        vox.view = std::mdspan<T, std::dextents<int, 3>>(vox.memory.data(), vox.size.z, vox.size.y, vox.size.x);
+        std::fill(vox.memory.begin(), vox.memory.end(), T{});
+        size_t index = 0;
+        for (int z = 0; z < size.z; ++z)
+            for (int y = 0; y < size.y; ++y)
+                for (int x = 0; x < size.x && index < source.size(); ++x)
+                    vox(x, y, z) = source[index++];
     }
-    ar(cereal::binary_data(vox.memory.data(), sizeof(T) * vox.memory.size()));
+    return vox;
+}
+
+// 转换内存布局, 例如在上传纹理前转回 std::layout_right
+template <typename To, typename T, typename From> static inline voxel<T, To> relayout(volume_view<const T, From> source)
+{
+    voxel<T, To> vox(source.size);
+    for (int z = 0; z < source.size.z; ++z)
+        for (int y = 0; y < source.size.y; ++y)
+            for (int x = 0; x < source.size.x; ++x)
+                vox(x, y, z) = source(x, y, z);
+    return vox;
 }
-template <typename Archive, typename T> void load_and_construct(Archive& ar, voxel<T>& vox, const unsigned int /*version*/)
+template <typename To, typename T, typename From> static inline voxel<T, To> relayout(const voxel<T, From>& source)
 {
-    ar(typeid(T).hash_code());
-    ar(vox.size);
-    vox.memory.resize(vox.size.x * vox.size.y * vox.size.z);
-    vox.view = std::mdspan<T, std::dextents<int, 3>>(vox.memory.data(), vox.size.z, vox.size.y, vox.size.x);
-    ar(cereal::binary_data(vox.memory.data(), sizeof(T) * vox.memory.size()));
+    return relayout<To>(as_view(source));
 }
@@ -0,0 +1,63 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+// 空域跳跃用的宏单元网格, 每个单元记录覆盖体素的最小值 (x) 和最大值 (y)
+// 单元向外多统计 border 个体素, 插值采样或落在单元边界附近的采样点也不会被错误跳过
+template <typename T> struct macro_cell_grid
+{
+    int cell_size = 8;
+    int border = 1;
+    glm::ivec3 volume_size{ 0 };
+    voxel<glm::vec<2, T>> cells; // index: 单元坐标
+
+    glm::ivec3 grid_size() const { return cells.size; }
+    glm::ivec3 cell_of(glm::ivec3 voxel_coord) const { return glm::clamp(voxel_coord / cell_size, glm::ivec3(0), cells.size - 1); }
+    glm::vec<2, T> range(glm::ivec3 cell) const { return cells(cell.x, cell.y, cell.z); }
+    // 单元内所有体素都低于阈值时可以整个跳过
+    bool empty(glm::ivec3 cell, T threshold) const { return range(cell).y < threshold; }
+};
+
+template <typename T> static inline macro_cell_grid<T> build_macro_cell_grid(volume_view<const T> vol, int cell_size = 8, int border = 1)
+{
+    macro_cell_grid<T> grid;
+    grid.cell_size = std::max(cell_size, 1);
+    grid.border = std::max(border, 0);
+    grid.volume_size = vol.size;
+    glm::ivec3 size = (vol.size + glm::ivec3(grid.cell_size - 1)) / grid.cell_size;
+    grid.cells = make_voxel<glm::vec<2, T>>(size);
+
+    size_t rows = static_cast<size_t>(size.y) * size.z;
+    parallel_for(0, rows, 1, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+        {
+            int cy = static_cast<int>(row % size.y);
+            int cz = static_cast<int>(row / size.y);
+            int y0 = std::max(cy * grid.cell_size - grid.border, 0), y1 = std::min((cy + 1) * grid.cell_size + grid.border, vol.size.y);
+            int z0 = std::max(cz * grid.cell_size - grid.border, 0), z1 = std::min((cz + 1) * grid.cell_size + grid.border, vol.size.z);
+            for (int cx = 0; cx < size.x; ++cx)
+            {
+                int x0 = std::max(cx * grid.cell_size - grid.border, 0), x1 = std::min((cx + 1) * grid.cell_size + grid.border, vol.size.x);
+                T lo = std::numeric_limits<T>::max();
+                T hi = std::numeric_limits<T>::lowest();
+                for (int z = z0; z < z1; ++z)
+                    for (int y = y0; y < y1; ++y)
+                    {
+                        const T* in = &vol(0, y, z);
+                        for (int x = x0; x < x1; ++x)
+                        {
+                            lo = in[x] < lo ? in[x] : lo;
+                            hi = in[x] > hi ? in[x] : hi;
+                        }
+                    }
+                grid.cells(cx, cy, cz) = { lo, hi };
+            }
+        }
+    });
+    return grid;
+}
@@ -0,0 +1,127 @@
+#include "mapped_file.hpp"
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+
+#if defined(_WIN32)
+std::expected<std::shared_ptr<mapped_file>, std::string> mapped_file::open(const std::filesystem::path& file, access_hint hint)
+{
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (hint == access_hint::sequential)
+        flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+    else if (hint == access_hint::random)
+        flags |= FILE_FLAG_RANDOM_ACCESS;
+
+    HANDLE file_handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE)
+        return std::unexpected(fmt::format("{}: open failed, error {}", file, GetLastError()));
+
+    std::shared_ptr<mapped_file> mapped(new mapped_file());
+    mapped->file_handle = file_handle;
+
+    LARGE_INTEGER file_size;
+    if (not GetFileSizeEx(file_handle, &file_size))
+        return std::unexpected(fmt::format("{}: query size failed, error {}", file, GetLastError()));
+    mapped->length = static_cast<size_t>(file_size.QuadPart);
+    if (mapped->length == 0)
+        return mapped;
+
+    mapped->mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapped->mapping_handle == nullptr)
+        return std::unexpected(fmt::format("{}: create mapping failed, error {}", file, GetLastError()));
+
+    mapped->data = static_cast<const std::byte*>(MapViewOfFile(mapped->mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (mapped->data == nullptr)
+        return std::unexpected(fmt::format("{}: map view failed, error {}", file, GetLastError()));
+
+    mapped->advise(hint);
+    return mapped;
+}
+
+mapped_file::~mapped_file()
+{
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mapping_handle != nullptr)
+        CloseHandle(mapping_handle);
+    if (file_handle != nullptr)
+        CloseHandle(file_handle);
+}
+
+void mapped_file::advise(access_hint hint, size_t offset, size_t count) const
+{
+    // Windows 只能在打开文件时指定顺序/随机访问, 这里只处理预读
+    if (data == nullptr || offset >= length || (hint != access_hint::sequential && hint != access_hint::will_need))
+        return;
+    WIN32_MEMORY_RANGE_ENTRY range{ const_cast<std::byte*>(data) + offset, std::min(count, length - offset) };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+#else
+std::expected<std::shared_ptr<mapped_file>, std::string> mapped_file::open(const std::filesystem::path& file, access_hint hint)
+{
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return std::unexpected(fmt::format("{}: open failed, errno {}", file, errno));
+
+    std::shared_ptr<mapped_file> mapped(new mapped_file());
+    mapped->fd = fd;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return std::unexpected(fmt::format("{}: query size failed, errno {}", file, errno));
+    mapped->length = static_cast<size_t>(st.st_size);
+    if (mapped->length == 0)
+        return mapped;
+
+    void* address = mmap(nullptr, mapped->length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED)
+        return std::unexpected(fmt::format("{}: mmap failed, errno {}", file, errno));
+    mapped->data = static_cast<const std::byte*>(address);
+
+    mapped->advise(hint);
+    return mapped;
+}
+
+mapped_file::~mapped_file()
+{
+    if (data != nullptr)
+        munmap(const_cast<std::byte*>(data), length);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+void mapped_file::advise(access_hint hint, size_t offset, size_t count) const
+{
+    if (data == nullptr || offset >= length)
+        return;
+    // madvise 要求起始地址按页对齐
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = offset / page_size * page_size;
+    size_t end = offset + std::min(count, length - offset);
+
+    int advice = MADV_NORMAL;
+    switch (hint)
+    {
+        case access_hint::normal: advice = MADV_NORMAL; break;
+        case access_hint::sequential: advice = MADV_SEQUENTIAL; break;
+        case access_hint::random: advice = MADV_RANDOM; break;
+        case access_hint::will_need: advice = MADV_WILLNEED; break;
+    }
+    madvise(const_cast<std::byte*>(data) + begin, end - begin, advice);
+}
+#endif
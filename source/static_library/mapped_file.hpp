@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+
+#include <fmt/format.h>
+#include <fmt/std.h>
+
+#include "interface/volume_view.hpp"
+
+// 访问模式提示, 对应 madvise / PrefetchVirtualMemory
+enum class access_hint
+{
+    normal,
+    sequential,
+    random,
+    will_need,
+};
+
+// 只读内存映射文件, 通过 shared_ptr 共享, 最后一个持有者释放映射
+class mapped_file
+{
+public:
+    static std::expected<std::shared_ptr<mapped_file>, std::string> open(const std::filesystem::path& file, access_hint hint = access_hint::normal);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    std::span<const std::byte> bytes() const { return { data, length }; }
+    size_t size() const { return length; }
+
+    // 对 [offset, offset + count) 给出访问模式提示, 失败时忽略
+    void advise(access_hint hint, size_t offset = 0, size_t count = static_cast<size_t>(-1)) const;
+
+private:
+    mapped_file() = default;
+
+    const std::byte* data = nullptr;
+    size_t length = 0;
+#if defined(_WIN32)
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+// 映射在文件上的只读体数据, 持有映射的生命周期
+template <typename T> struct mapped_voxel
+{
+    std::shared_ptr<mapped_file> file;
+    volume_view<const T> view;
+
+    operator volume_view<const T>() const { return view; }
+};
+
+// 将 raw 文件中 header_offset 之后按 z, y, x 排列的 T 数据映射为体数据视图, 不产生堆上拷贝
+template <typename T>
+static inline std::expected<mapped_voxel<T>, std::string> map_raw_volume(const std::filesystem::path& file, glm::ivec3 size, size_t header_offset = 0, access_hint hint = access_hint::sequential)
+{
+    auto mapped_ret = mapped_file::open(file, hint);
+    if (not mapped_ret.has_value())
+        return std::unexpected(mapped_ret.error());
+    auto& mapped = mapped_ret.value();
+
+    size_t count = static_cast<size_t>(size.x) * size.y * size.z;
+    if (header_offset % alignof(T) != 0)
+        return std::unexpected(fmt::format("{}: header offset {} is not aligned for {}-byte voxels", file, header_offset, alignof(T)));
+    if (header_offset + count * sizeof(T) > mapped->size())
+        return std::unexpected(fmt::format("{}: file has {} bytes, volume needs {}", file, mapped->size(), header_offset + count * sizeof(T)));
+
+    auto payload = mapped->bytes().subspan(header_offset, count * sizeof(T));
+    std::span<const T> memory(reinterpret_cast<const T*>(payload.data()), count);
+    return mapped_voxel<T>{ mapped, volume_view<const T>(size, memory) };
+}
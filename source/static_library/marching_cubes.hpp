@@ -0,0 +1,399 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "gradient_volume.hpp"
+#include "interface/voxel.hpp"
+#include "material_brick_index.hpp"
+#include "parallel_for.hpp"
+
+// 等值面网格顶点, 16 字节: 位置位于代理立方体 [-0.5, 0.5] 空间 (与 OpenglRasterizationFramer 的立方体一致)
+// normal 为八面体编码的单位法线 (gradient_volume_detail::encode_octahedral), 指向值减小的一侧; 三角形逆时针为正面, 正面朝外
+struct mesh_vertex
+{
+    glm::vec3 position;
+    glm::vec<2, uint8_t> normal;
+    uint16_t reserved = 0;
+};
+static_assert(sizeof(mesh_vertex) == 16);
+
+struct isosurface_mesh
+{
+    std::vector<mesh_vertex> vertices;
+    std::vector<uint32_t> indices; // GL_TRIANGLES
+};
+
+namespace marching_cubes_detail
+{
+    // 角点 i 位于 (i & 1, (i >> 1) & 1, (i >> 2) & 1); 棱按轴分组, 棱 axis * 4 + k 从角点 corner 沿 axis 方向延伸
+    struct cube_edge
+    {
+        int corner;
+        int axis;
+    };
+    constexpr std::array<cube_edge, 12> cube_edges()
+    {
+        std::array<cube_edge, 12> edges{};
+        int n = 0;
+        for (int axis = 0; axis < 3; ++axis)
+            for (int corner = 0; corner < 8; ++corner)
+                if ((corner & (1 << axis)) == 0)
+                    edges[n++] = { corner, axis };
+        return edges;
+    }
+
+    // 每种角点组合 (第 i 位为角点 i 在内部, 即 >= 等值) 的三角形, 元素为棱序号
+    struct case_table
+    {
+        std::array<std::array<int8_t, 15>, 256> triangles; // 按此规则最多 5 个三角形
+        std::array<uint8_t, 256> count; // 三角形数 * 3
+    };
+
+    // 6 个面, 角点按从外侧看的逆时针顺序
+    constexpr std::array<std::array<int, 4>, 6> cube_faces()
+    {
+        std::array<std::array<int, 4>, 6> faces{};
+        for (int axis = 0; axis < 3; ++axis)
+            for (int side = 0; side < 2; ++side)
+            {
+                int b = (axis + 1) % 3, c = (axis + 2) % 3;
+                std::array<int, 4> quad{};
+                const int uv[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+                for (int k = 0; k < 4; ++k)
+                    quad[k] = (side << axis) | (uv[k][0] << b) | (uv[k][1] << c);
+                if (side == 0)
+                    std::reverse(quad.begin(), quad.end());
+                faces[axis * 2 + side] = quad;
+            }
+        return faces;
+    }
+
+    constexpr int edge_between(const std::array<cube_edge, 12>& edges, int a, int b)
+    {
+        for (int i = 0; i < 12; ++i)
+        {
+            int lo = edges[i].corner, hi = lo | (1 << edges[i].axis);
+            if ((lo == a && hi == b) || (lo == b && hi == a))
+                return i;
+        }
+        return -1;
+    }
+
+    // face_edges[f] 的第 e 位表示棱 e 在面 f 上
+    constexpr std::array<uint16_t, 6> cube_face_edges()
+    {
+        auto edges = cube_edges();
+        std::array<uint16_t, 6> masks{};
+        auto faces = cube_faces();
+        for (int f = 0; f < 6; ++f)
+            for (int k = 0; k < 4; ++k)
+                masks[f] |= static_cast<uint16_t>(1u << edge_between(edges, faces[f][k], faces[f][(k + 1) % 4]));
+        return masks;
+    }
+
+    constexpr bool on_same_face(const std::array<uint16_t, 6>& face_edges, int a, int b)
+    {
+        for (auto mask : face_edges)
+            if ((mask >> a & 1) && (mask >> b & 1))
+                return true;
+        return false;
+    }
+
+    // 不照抄经典的 256 项表, 而是在编译期按规则生成:
+    // 每个面上的截线从 "内 -> 外" 的棱连到 "外 -> 内" 的棱 (沿从外侧看的逆时针方向), 两个对角内部角点的歧义面总是把内部角点分开
+    // 该规则只取决于面上的四个角点, 相邻立方体在公共面上得到同样的截线, 网格没有裂缝; 截线首尾相接成环后按扇形三角化
+    // 一个环可能两次经过同一个歧义面, 扇形的对角线若落在面内, 面另一侧的立方体会生成同向的同一条边, 因此扇形的起点选在
+    // 所有对角线都不与起点共面的位置 (256 种组合都存在这样的起点)
+    constexpr case_table build_case_table()
+    {
+        auto edges = cube_edges();
+        auto faces = cube_faces();
+        auto face_edges = cube_face_edges();
+        // 角点对到棱的查找表, 避免在 256 种组合中反复线性查找
+        std::array<std::array<int, 8>, 8> edge_of{};
+        for (int a = 0; a < 8; ++a)
+            for (int b = 0; b < 8; ++b)
+                edge_of[a][b] = edge_between(edges, a, b);
+
+        case_table table{};
+        for (int config = 0; config < 256; ++config)
+        {
+            std::array<int, 12> next{};
+            next.fill(-1);
+            for (const auto& quad : faces)
+            {
+                bool inside[4]{};
+                for (int k = 0; k < 4; ++k)
+                    inside[k] = (config >> quad[k]) & 1;
+                for (int k = 0; k < 4; ++k)
+                {
+                    // 棱 e_k 连接 quad[k] 与 quad[k + 1], 内 -> 外时为离开棱
+                    int succ = (k + 1) % 4;
+                    if (not inside[k] || inside[succ])
+                        continue;
+                    // 从 quad[k] 往回走过连续的内部角点, 找到进入这段内部角点的棱; 两个对角内部角点时即 e_(k-1), 把内部角点分开
+                    int enter = k;
+                    for (int step = 0; step < 4; ++step)
+                    {
+                        int j = (k + 4 - step) % 4;
+                        int before = (j + 3) % 4;
+                        if (inside[j] && not inside[before])
+                        {
+                            enter = before;
+                            break;
+                        }
+                    }
+                    next[edge_of[quad[k]][quad[succ]]] = edge_of[quad[enter]][quad[(enter + 1) % 4]];
+                }
+            }
+            std::array<bool, 12> visited{};
+            int count = 0;
+            for (int start = 0; start < 12; ++start)
+            {
+                if (next[start] < 0 || visited[start])
+                    continue;
+                std::array<int, 12> loop{};
+                int n = 0;
+                for (int e = start; not visited[e]; e = next[e])
+                {
+                    visited[e] = true;
+                    loop[n++] = e;
+                }
+                for (int r = 0; r < n; ++r)
+                {
+                    bool flat = false;
+                    for (int i = 2; i + 1 < n; ++i)
+                        flat |= on_same_face(face_edges, loop[r], loop[(r + i) % n]);
+                    if (flat)
+                        continue;
+                    std::rotate(loop.begin(), loop.begin() + r, loop.begin() + n);
+                    break;
+                }
+                for (int i = 1; i + 1 < n; ++i)
+                {
+                    table.triangles[config][count++] = static_cast<int8_t>(loop[0]);
+                    table.triangles[config][count++] = static_cast<int8_t>(loop[i]);
+                    table.triangles[config][count++] = static_cast<int8_t>(loop[i + 1]);
+                }
+            }
+            table.count[config] = static_cast<uint8_t>(count);
+        }
+
+        // 统一绕序: 只有角点 0 在内部时, 法线应指向 (1, 1, 1); 棱中点取 2 倍坐标, 全部用整数计算
+        auto midpoint = [&](int e) {
+            std::array<int, 3> m{};
+            for (int k = 0; k < 3; ++k)
+                m[k] = ((edges[e].corner >> k) & 1) * 2 + (edges[e].axis == k ? 1 : 0);
+            return m;
+        };
+        const auto& probe = table.triangles[1];
+        auto p0 = midpoint(probe[0]), p1 = midpoint(probe[1]), p2 = midpoint(probe[2]);
+        std::array<int, 3> u = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        std::array<int, 3> v = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        int normal_sum = (u[1] * v[2] - u[2] * v[1]) + (u[2] * v[0] - u[0] * v[2]) + (u[0] * v[1] - u[1] * v[0]);
+        if (normal_sum < 0)
+            for (auto& tris : table.triangles)
+                for (size_t i = 0; i + 2 < tris.size(); i += 3)
+                    std::swap(tris[i + 1], tris[i + 2]);
+        return table;
+    }
+
+    // 检查每种组合: 面上的截线 (两端棱共面) 只出现一次, 由面另一侧的立方体反向补齐; 立方体内部的边恰好被两个三角形反向共用
+    constexpr bool validate_case_table(const case_table& table)
+    {
+        auto face_edges = cube_face_edges();
+        for (int config = 0; config < 256; ++config)
+        {
+            std::array<std::array<int, 12>, 12> used{};
+            for (int k = 0; k < table.count[config]; k += 3)
+                for (int i = 0; i < 3; ++i)
+                {
+                    int a = table.triangles[config][k + i], b = table.triangles[config][k + (i + 1) % 3];
+                    if (a == b)
+                        return false;
+                    ++used[a][b];
+                }
+            for (int a = 0; a < 12; ++a)
+                for (int b = 0; b < 12; ++b)
+                {
+                    if (used[a][b] == 0)
+                        continue;
+                    bool segment = on_same_face(face_edges, a, b);
+                    if (used[a][b] != 1 || used[b][a] != (segment ? 0 : 1))
+                        return false;
+                }
+        }
+        return true;
+    }
+
+    // 编译期生成并检查, 运行时不再构建
+    inline constexpr case_table case_table_data = build_case_table();
+    static_assert(validate_case_table(case_table_data), "marching cubes case table is not manifold");
+
+    static inline const case_table& cases()
+    {
+        return case_table_data;
+    }
+
+    constexpr uint32_t foreign_bit = 0x80000000u; // 引用下一段底面上的棱, 合并时解析
+
+    // 一段 z 层立方体 [z0, z1) 的结果, 顶点序号为段内局部序号
+    struct block
+    {
+        int z0 = 0;
+        int z1 = 0;
+        bool last = false;
+        std::vector<mesh_vertex> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<int32_t> bottom; // 底面 (z0) 上 x / y 方向棱的顶点序号, index: (y * nx + x) * 2 + axis
+        uint32_t offset = 0;
+    };
+
+    // field(x, y, z) 返回标量场, >= iso 为内部
+    template <typename Field> static inline isosurface_mesh extract(glm::ivec3 size, float iso, Field&& field, int slab_depth)
+    {
+        isosurface_mesh mesh;
+        if (glm::any(glm::lessThan(size, glm::ivec3(2))))
+            return mesh;
+        const auto& table = cases();
+        const auto edges = cube_edges();
+        int nx = size.x, ny = size.y;
+        size_t plane = static_cast<size_t>(nx) * ny;
+        glm::ivec3 cubes = size - 1;
+        glm::vec3 inv_size = 1.0f / glm::vec3(size);
+
+        if (slab_depth <= 0)
+            slab_depth = std::max(4, cubes.z / static_cast<int>(parallel_worker_count() * 4));
+        std::vector<block> blocks;
+        for (int z = 0; z < cubes.z; z += slab_depth)
+            blocks.push_back({ z, std::min(z + slab_depth, cubes.z) });
+        blocks.back().last = true;
+
+        auto gradient = [&](int x, int y, int z) {
+            int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, size.x - 1);
+            int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, size.y - 1);
+            int z0 = std::max(z - 1, 0), z1 = std::min(z + 1, size.z - 1);
+            return glm::vec3((field(x1, y, z) - field(x0, y, z)) / static_cast<float>(std::max(x1 - x0, 1)), (field(x, y1, z) - field(x, y0, z)) / static_cast<float>(std::max(y1 - y0, 1)),
+                             (field(x, y, z1) - field(x, y, z0)) / static_cast<float>(std::max(z1 - z0, 1)));
+        };
+
+        parallel_for(0, blocks.size(), 1, [&](size_t begin, size_t end) {
+            // 当前层底面 / 顶面的 x, y 方向棱和层内 z 方向棱的顶点序号, -1 表示尚未生成
+            std::vector<int32_t> lower(plane * 2), upper(plane * 2), vertical(plane);
+            for (size_t b = begin; b < end; ++b)
+            {
+                auto& blk = blocks[b];
+                std::fill(lower.begin(), lower.end(), -1);
+                auto make_vertex = [&](glm::ivec3 p, int axis) {
+                    glm::ivec3 q = p;
+                    q[axis] += 1;
+                    float f0 = field(p.x, p.y, p.z), f1 = field(q.x, q.y, q.z);
+                    float t = std::clamp((iso - f0) / (f1 - f0), 0.0f, 1.0f);
+                    glm::vec3 pos = glm::vec3(p);
+                    pos[axis] += t;
+                    glm::vec3 g = glm::mix(gradient(p.x, p.y, p.z), gradient(q.x, q.y, q.z), t);
+                    float length = glm::length(g);
+                    mesh_vertex v;
+                    v.position = (pos + 0.5f) * inv_size - 0.5f;
+                    v.normal = gradient_volume_detail::encode_octahedral(length > 0.0f ? -g / length : glm::vec3(0.0f));
+                    blk.vertices.push_back(v);
+                    return static_cast<uint32_t>(blk.vertices.size() - 1);
+                };
+                for (int z = blk.z0; z < blk.z1; ++z)
+                {
+                    bool top_foreign = z + 1 == blk.z1 && not blk.last;
+                    std::fill(upper.begin(), upper.end(), -1);
+                    std::fill(vertical.begin(), vertical.end(), -1);
+                    for (int y = 0; y < cubes.y; ++y)
+                        for (int x = 0; x < cubes.x; ++x)
+                        {
+                            int config = 0;
+                            for (int c = 0; c < 8; ++c)
+                                config |= (field(x + (c & 1), y + ((c >> 1) & 1), z + ((c >> 2) & 1)) >= iso) << c;
+                            if (config == 0 || config == 255)
+                                continue;
+                            for (int k = 0; k < table.count[config]; ++k)
+                            {
+                                int e = table.triangles[config][k];
+                                int corner = edges[e].corner;
+                                int axis = edges[e].axis;
+                                glm::ivec3 p = { x + (corner & 1), y + ((corner >> 1) & 1), z + ((corner >> 2) & 1) };
+                                size_t cell = static_cast<size_t>(p.y) * nx + p.x;
+                                if (axis != 2 && p.z != z && top_foreign)
+                                {
+                                    blk.indices.push_back(foreign_bit | static_cast<uint32_t>(cell * 2 + axis));
+                                    continue;
+                                }
+                                auto& slot = axis == 2 ? vertical[cell] : (p.z == z ? lower : upper)[cell * 2 + axis];
+                                if (slot < 0)
+                                    slot = static_cast<int32_t>(make_vertex(p, axis));
+                                blk.indices.push_back(static_cast<uint32_t>(slot));
+                            }
+                        }
+                    if (z == blk.z0)
+                        blk.bottom = lower;
+                    std::swap(lower, upper);
+                }
+            }
+        });
+
+        // 顶点按段顺序拼接, 引用下一段底面的棱时查该段的 bottom 表
+        size_t vertex_count = 0, index_count = 0;
+        std::vector<size_t> index_offset(blocks.size());
+        for (size_t b = 0; b < blocks.size(); ++b)
+        {
+            blocks[b].offset = static_cast<uint32_t>(vertex_count);
+            index_offset[b] = index_count;
+            vertex_count += blocks[b].vertices.size();
+            index_count += blocks[b].indices.size();
+        }
+        mesh.vertices.resize(vertex_count);
+        mesh.indices.resize(index_count);
+        parallel_for(0, blocks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; ++b)
+            {
+                const auto& blk = blocks[b];
+                std::copy(blk.vertices.begin(), blk.vertices.end(), mesh.vertices.begin() + blk.offset);
+                uint32_t* out = mesh.indices.data() + index_offset[b];
+                for (size_t i = 0; i < blk.indices.size(); ++i)
+                {
+                    uint32_t id = blk.indices[i];
+                    if (id & foreign_bit)
+                        out[i] = blocks[b + 1].offset + static_cast<uint32_t>(blocks[b + 1].bottom[id & ~foreign_bit]);
+                    else
+                        out[i] = blk.offset + id;
+                }
+            }
+        });
+        return mesh;
+    }
+} // namespace marching_cubes_detail
+
+// 多线程 marching cubes, 体数据按 z 方向分段并行, 段内用逐层的棱缓存去重顶点, 段间的共享顶点在合并时按棱解析
+// 每条被穿过的格点棱只生成一个顶点, 得到无重复顶点, 绕序一致的索引网格 (表面碰到体边界处不封闭)
+template <typename T> static inline isosurface_mesh extract_isosurface(volume_view<const T> vol, float iso, int slab_depth = 0)
+{
+    return marching_cubes_detail::extract(vol.size, iso, [&](int x, int y, int z) { return static_cast<float>(vol(x, y, z)); }, slab_depth);
+}
+template <typename T> static inline isosurface_mesh extract_isosurface(const voxel<T>& vol, float iso, int slab_depth = 0)
+{
+    return extract_isosurface(as_view(vol), iso, slab_depth);
+}
+
+// 材料标签体中 selection 所含类别的表面, 顶点位于棱的中点
+static inline isosurface_mesh extract_material_surface(volume_view<const uint8_t> labels, const material_set& selection, int slab_depth = 0)
+{
+    std::array<float, 256> inside{};
+    for (int label = 0; label < 256; ++label)
+        inside[label] = selection[label] ? 1.0f : 0.0f;
+    return marching_cubes_detail::extract(labels.size, 0.5f, [&](int x, int y, int z) { return inside[labels(x, y, z)]; }, slab_depth);
+}
+static inline isosurface_mesh extract_material_surface(const voxel<uint8_t>& labels, const material_set& selection, int slab_depth = 0)
+{
+    return extract_material_surface(as_view(labels), selection, slab_depth);
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+// 材料类别集合, 第 i 位对应标签 i
+using material_set = std::bitset<256>;
+
+// 材料标签体的分块存在性索引: 每个砖块记录其中出现过的材料类别
+// 只显示部分材料时, 不含所选类别的砖块可以整块跳过, 开销与实际命中的砖块数成正比
+struct material_brick_index
+{
+    int brick_size = 16;
+    glm::ivec3 volume_size{ 0 };
+    glm::ivec3 bricks{ 0 };
+    std::vector<material_set> masks; // index: (bz * bricks.y + by) * bricks.x + bx
+    material_set present;            // 整个体中出现过的类别
+
+    size_t brick_count() const { return masks.size(); }
+    size_t brick_index(glm::ivec3 brick) const { return (static_cast<size_t>(brick.z) * bricks.y + brick.y) * bricks.x + brick.x; }
+    glm::ivec3 brick_coord(size_t index) const
+    {
+        return { static_cast<int>(index % bricks.x), static_cast<int>(index / bricks.x % bricks.y), static_cast<int>(index / bricks.x / bricks.y) };
+    }
+    glm::ivec3 brick_of(glm::ivec3 voxel_coord) const { return glm::clamp(voxel_coord / brick_size, glm::ivec3(0), bricks - 1); }
+
+    // 砖块中是否出现了 classes 中的任一类别
+    bool contains(glm::ivec3 brick, const material_set& classes) const { return (masks[brick_index(brick)] & classes).any(); }
+    bool contains(glm::ivec3 brick, uint8_t label) const { return masks[brick_index(brick)][label]; }
+
+    // 含有 classes 中任一类别的砖块序号, 按内存顺序排列
+    std::vector<uint32_t> bricks_with(const material_set& classes) const
+    {
+        std::vector<uint32_t> result;
+        if ((present & classes).none())
+            return result;
+        for (size_t i = 0; i < masks.size(); ++i)
+            if ((masks[i] & classes).any())
+                result.push_back(static_cast<uint32_t>(i));
+        return result;
+    }
+    std::vector<uint32_t> bricks_with(uint8_t label) const
+    {
+        material_set classes;
+        classes[label] = true;
+        return bricks_with(classes);
+    }
+    // 与 bricks_with(classes).size() 相同, 但不分配内存
+    size_t count_bricks_with(const material_set& classes) const
+    {
+        if ((present & classes).none())
+            return 0;
+        return static_cast<size_t>(std::count_if(masks.begin(), masks.end(), [&](const material_set& mask) { return (mask & classes).any(); }));
+    }
+
+    // 每砖块一个字节 (1: 含所选类别), 供 texture_from 上传给着色器按砖块跳过
+    voxel<uint8_t> selection(const material_set& classes) const
+    {
+        voxel<uint8_t> result = make_voxel<uint8_t>(bricks);
+        parallel_for(0, masks.size(), 4096, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                result.memory[i] = (masks[i] & classes).any() ? 1 : 0;
+        });
+        return result;
+    }
+};
+
+// 按砖块行并行扫描标签体, 每个砖块先在 256 项的局部表中标记, 再压缩成位集合
+static inline material_brick_index build_material_brick_index(volume_view<const uint8_t> labels, int brick_size = 16)
+{
+    material_brick_index index;
+    index.brick_size = std::max(brick_size, 1);
+    index.volume_size = labels.size;
+    index.bricks = (labels.size + glm::ivec3(index.brick_size - 1)) / index.brick_size;
+    index.masks.assign(static_cast<size_t>(index.bricks.x) * index.bricks.y * index.bricks.z, material_set{});
+    if (index.masks.empty())
+        return index;
+
+    size_t rows = static_cast<size_t>(index.bricks.y) * index.bricks.z;
+    parallel_for(0, rows, 1, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+        {
+            int by = static_cast<int>(row % index.bricks.y);
+            int bz = static_cast<int>(row / index.bricks.y);
+            int y0 = by * index.brick_size, y1 = std::min(y0 + index.brick_size, labels.size.y);
+            int z0 = bz * index.brick_size, z1 = std::min(z0 + index.brick_size, labels.size.z);
+            for (int bx = 0; bx < index.bricks.x; ++bx)
+            {
+                int x0 = bx * index.brick_size, x1 = std::min(x0 + index.brick_size, labels.size.x);
+                uint8_t seen[256] = {};
+                for (int z = z0; z < z1; ++z)
+                    for (int y = y0; y < y1; ++y)
+                    {
+                        const uint8_t* in = &labels(0, y, z);
+                        for (int x = x0; x < x1; ++x)
+                            seen[in[x]] = 1;
+                    }
+                material_set& mask = index.masks[index.brick_index({ bx, by, bz })];
+                for (int label = 0; label < 256; ++label)
+                    if (seen[label])
+                        mask[label] = true;
+            }
+        }
+    });
+    for (const auto& mask : index.masks)
+        index.present |= mask;
+    return index;
+}
+static inline material_brick_index build_material_brick_index(const voxel<uint8_t>& labels, int brick_size = 16)
+{
+    return build_material_brick_index(as_view(labels), brick_size);
+}
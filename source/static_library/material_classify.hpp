@@ -0,0 +1,138 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/bricked_voxel.hpp"
+#include "interface/pixel.hpp"
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+// 双能材料查找表, labels 的 x 轴为低能值 (miu), y 轴为高能值 (Zeff)
+// 输入值 v 映射到 bin = min(v * size / (value_max + 1), size - 1), 用 16.16 定点乘法代替除法
+struct material_lut
+{
+    glm::ivec2 size{ 0 };
+    glm::uvec2 value_max{ 255 }; // 映射到最后一个 bin 的输入值 (le, he)
+    std::vector<uint8_t> labels; // index: he_bin * size.x + le_bin
+
+    // bin = (v * scale) >> 16, scale 不超过 1.0 (65536) 以保证 16 位输入的乘积不溢出 32 位
+    glm::uvec2 scale() const
+    {
+        auto axis = [](int bins, uint32_t max) { return static_cast<uint32_t>(std::min<uint64_t>((static_cast<uint64_t>(bins) << 16) / (static_cast<uint64_t>(max) + 1), 65536)); };
+        return { axis(size.x, value_max.x), axis(size.y, value_max.y) };
+    }
+    uint8_t operator()(uint16_t le, uint16_t he) const
+    {
+        glm::uvec2 s = scale();
+        uint32_t x = std::min<uint32_t>((static_cast<uint32_t>(le) * s.x) >> 16, size.x - 1);
+        uint32_t y = std::min<uint32_t>((static_cast<uint32_t>(he) * s.y) >> 16, size.y - 1);
+        return labels[static_cast<size_t>(y) * size.x + x];
+    }
+};
+
+// 直接使用标签图像作为查找表
+static inline material_lut make_material_lut(const pixel<uint8_t>& labels, glm::uvec2 value_max = glm::uvec2(255))
+{
+    material_lut lut;
+    lut.size = labels.size;
+    lut.value_max = value_max;
+    lut.labels.assign(labels.memory.begin(), labels.memory.end());
+    return lut;
+}
+
+// 由 RGBA 颜色表 (dr_color_table.bmp) 生成查找表, 相同颜色视为同一材料
+// 标签按颜色首次出现的顺序编号, palette[label] 为对应颜色; 超过 256 种颜色时其余颜色都归入 255
+static inline material_lut make_material_lut(const pixel<uint32_t>& color_table, std::vector<uint32_t>& palette, glm::uvec2 value_max = glm::uvec2(255))
+{
+    material_lut lut;
+    lut.size = color_table.size;
+    lut.value_max = value_max;
+    lut.labels.resize(color_table.memory.size());
+    palette.clear();
+    std::unordered_map<uint32_t, uint8_t> index;
+    for (size_t i = 0; i < color_table.memory.size(); ++i)
+    {
+        uint32_t color = color_table.memory[i];
+        auto it = index.find(color);
+        if (it == index.end())
+        {
+            auto label = static_cast<uint8_t>(std::min<size_t>(palette.size(), 255));
+            if (palette.size() < 256)
+                palette.push_back(color);
+            it = index.emplace(color, label).first;
+        }
+        lut.labels[i] = it->second;
+    }
+    return lut;
+}
+
+namespace material_classify_detail
+{
+    // 连续 count 个体素的分类
+    // 循环没有分支 (bin 用 min 钳制), 查表为 gather, 交给编译器向量化; 256x256 的表只占 64 KB, 常驻缓存
+    static inline void classify_span(const uint16_t* in_le, const uint16_t* in_he, uint8_t* out, size_t count, const material_lut& lut)
+    {
+        glm::uvec2 scale = lut.scale();
+        uint32_t max_x = static_cast<uint32_t>(lut.size.x - 1);
+        uint32_t max_y = static_cast<uint32_t>(lut.size.y - 1);
+        uint32_t stride = static_cast<uint32_t>(lut.size.x);
+        const uint8_t* table = lut.labels.data();
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t bx = std::min((static_cast<uint32_t>(in_le[i]) * scale.x) >> 16, max_x);
+            uint32_t by = std::min((static_cast<uint32_t>(in_he[i]) * scale.y) >> 16, max_y);
+            out[i] = table[by * stride + bx];
+        }
+    }
+} // namespace material_classify_detail
+
+// 合并 le/he 两个体为每体素一字节的材料标签体, 按行并行
+static inline voxel<uint8_t> classify_materials(volume_view<const uint16_t> le, volume_view<const uint16_t> he, const material_lut& lut)
+{
+    glm::ivec3 size = glm::min(le.size, he.size);
+    voxel<uint8_t> labels = make_voxel<uint8_t>(size);
+    if (labels.memory.empty() || lut.labels.empty())
+    {
+        std::fill(labels.memory.begin(), labels.memory.end(), uint8_t(0));
+        return labels;
+    }
+
+    size_t rows = static_cast<size_t>(size.y) * size.z;
+    parallel_for(0, rows, 64, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = static_cast<int>(row % size.y);
+            int z = static_cast<int>(row / size.y);
+            material_classify_detail::classify_span(&le(0, y, z), &he(0, y, z), &labels(0, y, z), static_cast<size_t>(size.x), lut);
+        }
+    });
+    return labels;
+}
+
+// 分块体数据按砖块并行分类, 结果与输入使用相同的砖块排列; 每个砖块在内存中连续, 整块一次处理 (包括边缘的填充部分)
+// le 与 he 尺寸不同时砖块无法一一对应, 退回连续体数据的路径并取交集
+template <int N> static inline bricked_voxel<uint8_t, N> classify_materials(const bricked_voxel<uint16_t, N>& le, const bricked_voxel<uint16_t, N>& he, const material_lut& lut)
+{
+    if (le.size != he.size)
+        return make_bricked_voxel<uint8_t, N>(classify_materials(as_view(to_voxel(le)), as_view(to_voxel(he)), lut));
+    bricked_voxel<uint8_t, N> labels = make_bricked_voxel<uint8_t, N>(le.size);
+    if (labels.memory.empty() || lut.labels.empty())
+        return labels;
+    parallel_for(0, labels.brick_count(), 4, [&](size_t begin, size_t end) {
+        size_t offset = begin * labels.brick_volume;
+        material_classify_detail::classify_span(le.memory.data() + offset, he.memory.data() + offset, labels.memory.data() + offset, (end - begin) * labels.brick_volume, lut);
+    });
+    return labels;
+}
+
+template <typename Layout> static inline voxel<uint8_t> classify_materials(const voxel<uint16_t, Layout>& le, const voxel<uint16_t, Layout>& he, const material_lut& lut)
+{
+    if constexpr (std::is_same_v<Layout, std::layout_right>)
+        return classify_materials(as_view(le), as_view(he), lut);
+    else
+        return classify_materials(as_view(relayout<std::layout_right>(le)), as_view(relayout<std::layout_right>(he)), lut);
+}
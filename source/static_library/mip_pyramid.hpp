@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+enum class mip_reduction
+{
+    average,
+    min,
+    max,
+};
+
+// 多分辨率金字塔, level 0 为源数据 (不持有), 之后每级每个轴减半
+// 尺寸按 OpenGL 规则 max(1, floor(size / 2)), 奇数尺寸时每个轴的最后一个体素覆盖 3 个源体素, 不丢弃数据
+template <typename T> struct mip_pyramid
+{
+    mip_reduction reduction = mip_reduction::average;
+    volume_view<const T> base;
+    std::vector<voxel<T>> levels; // levels[i] 为第 i + 1 级
+
+    int level_count() const { return base.memory.empty() ? 0 : static_cast<int>(levels.size()) + 1; }
+    volume_view<const T> level(int index) const { return index == 0 ? base : as_view(levels[index - 1]); }
+    glm::ivec3 level_size(int index) const { return level(index).size; }
+
+    // 每个屏幕像素覆盖 footprint 个源体素时应使用的级别
+    int level_for(float footprint) const
+    {
+        if (footprint <= 1.0f)
+            return 0;
+        return std::min(static_cast<int>(std::floor(std::log2(footprint))), level_count() - 1);
+    }
+
+    // 归一化坐标 [0, 1] 的最近邻采样, 用于预览和 CPU 端 LOD 光线步进
+    T sample(int index, glm::vec3 coord) const
+    {
+        auto vol = level(index);
+        glm::ivec3 p = glm::clamp(glm::ivec3(coord * glm::vec3(vol.size)), glm::ivec3(0), vol.size - 1);
+        return vol(p.x, p.y, p.z);
+    }
+};
+
+namespace mip_pyramid_detail
+{
+    static inline int next_size(int size)
+    {
+        return std::max(1, size / 2);
+    }
+    // 目标体素 i 覆盖的源区间 [2i, 2i + 2), 最后一个体素延伸到源末尾
+    static inline int source_end(int i, int dst_size, int src_size)
+    {
+        return i == dst_size - 1 ? src_size : std::min(2 * i + 2, src_size);
+    }
+
+    template <typename T> using accumulate_t = std::conditional_t<std::is_floating_point_v<T>, double, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+} // namespace mip_pyramid_detail
+
+// 缩小一级, 按目标行并行
+template <typename T> static inline voxel<T> downsample(volume_view<const T> src, mip_reduction reduction)
+{
+    using namespace mip_pyramid_detail;
+    glm::ivec3 size = { next_size(src.size.x), next_size(src.size.y), next_size(src.size.z) };
+    voxel<T> dst = make_voxel<T>(size);
+    size_t rows = static_cast<size_t>(size.y) * size.z;
+    parallel_for(0, rows, 16, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = static_cast<int>(row % size.y);
+            int z = static_cast<int>(row / size.y);
+            int y0 = 2 * y, y1 = source_end(y, size.y, src.size.y);
+            int z0 = 2 * z, z1 = source_end(z, size.z, src.size.z);
+            T* out = &dst(0, y, z);
+            for (int x = 0; x < size.x; ++x)
+            {
+                int x0 = 2 * x, x1 = source_end(x, size.x, src.size.x);
+                accumulate_t<T> sum = 0;
+                T lo = std::numeric_limits<T>::max();
+                T hi = std::numeric_limits<T>::lowest();
+                for (int sz = z0; sz < z1; ++sz)
+                    for (int sy = y0; sy < y1; ++sy)
+                    {
+                        const T* in = &src(0, sy, sz);
+                        for (int sx = x0; sx < x1; ++sx)
+                        {
+                            sum += in[sx];
+                            lo = in[sx] < lo ? in[sx] : lo;
+                            hi = in[sx] > hi ? in[sx] : hi;
+                        }
+                    }
+                switch (reduction)
+                {
+                    case mip_reduction::average:
+                    {
+                        auto count = static_cast<accumulate_t<T>>((x1 - x0) * (y1 - y0) * (z1 - z0));
+                        if constexpr (std::is_floating_point_v<T>)
+                            out[x] = static_cast<T>(sum / count);
+                        else
+                            out[x] = static_cast<T>(std::round(static_cast<double>(sum) / static_cast<double>(count)));
+                        break;
+                    }
+                    case mip_reduction::min: out[x] = lo; break;
+                    case mip_reduction::max: out[x] = hi; break;
+                }
+            }
+        }
+    });
+    return dst;
+}
+
+// 构建到 1x1x1 或 max_levels 级为止 (含 level 0), 源数据须在金字塔使用期间保持有效
+template <typename T> static inline mip_pyramid<T> build_mip_pyramid(volume_view<const T> src, mip_reduction reduction = mip_reduction::average, int max_levels = -1)
+{
+    mip_pyramid<T> pyramid;
+    pyramid.reduction = reduction;
+    pyramid.base = src;
+    if (src.memory.empty())
+        return pyramid;
+    volume_view<const T> current = src;
+    while ((max_levels < 0 || pyramid.level_count() < max_levels) && current.size != glm::ivec3(1))
+    {
+        pyramid.levels.push_back(downsample(current, reduction));
+        current = as_view(pyramid.levels.back());
+    }
+    return pyramid;
+}
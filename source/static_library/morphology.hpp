@@ -0,0 +1,347 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/aligned_buffer.hpp"
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+enum class morphology_op
+{
+    dilate, // 邻域最大值
+    erode,  // 邻域最小值
+    open,   // 先腐蚀后膨胀, 去掉小于结构元的亮斑点
+    close,  // 先膨胀后腐蚀, 填上小于结构元的空洞
+};
+
+// 按位打包的二值体, 每行 (x 方向) 占 row_words 个 64 位字, 第 x 位位于字 x / 64 的第 x % 64 位
+struct packed_mask
+{
+    glm::ivec3 size{ 0 };
+    int row_words = 0;
+    aligned_buffer<uint64_t> bits;
+
+    uint64_t* row(int y, int z) { return bits.data() + (static_cast<size_t>(z) * size.y + y) * row_words; }
+    const uint64_t* row(int y, int z) const { return bits.data() + (static_cast<size_t>(z) * size.y + y) * row_words; }
+    bool operator()(int x, int y, int z) const { return (row(y, z)[x >> 6] >> (x & 63)) & 1; }
+};
+
+// 非 0 体素为前景
+static inline packed_mask pack_mask(volume_view<const uint8_t> vol)
+{
+    packed_mask mask;
+    mask.size = vol.size;
+    mask.row_words = (vol.size.x + 63) / 64;
+    mask.bits.resize(static_cast<size_t>(mask.row_words) * vol.size.y * vol.size.z);
+    parallel_for(0, static_cast<size_t>(vol.size.y) * vol.size.z, 64, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r)
+        {
+            int y = static_cast<int>(r % vol.size.y);
+            int z = static_cast<int>(r / vol.size.y);
+            const uint8_t* in = &vol(0, y, z);
+            uint64_t* out = mask.row(y, z);
+            for (int w = 0; w < mask.row_words; ++w)
+            {
+                uint64_t word = 0;
+                int count = std::min(64, vol.size.x - w * 64);
+                for (int b = 0; b < count; ++b)
+                    word |= static_cast<uint64_t>(in[w * 64 + b] != 0) << b;
+                out[w] = word;
+            }
+        }
+    });
+    return mask;
+}
+static inline packed_mask pack_mask(const voxel<uint8_t>& vol)
+{
+    return pack_mask(as_view(vol));
+}
+
+// 前景为 1, 背景为 0
+static inline voxel<uint8_t> unpack_mask(const packed_mask& mask)
+{
+    voxel<uint8_t> vol = make_voxel<uint8_t>(mask.size);
+    parallel_for(0, static_cast<size_t>(mask.size.y) * mask.size.z, 64, [&](size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r)
+        {
+            int y = static_cast<int>(r % mask.size.y);
+            int z = static_cast<int>(r / mask.size.y);
+            const uint64_t* in = mask.row(y, z);
+            uint8_t* out = &vol(0, y, z);
+            for (int x = 0; x < mask.size.x; ++x)
+                out[x] = static_cast<uint8_t>((in[x >> 6] >> (x & 63)) & 1);
+        }
+    });
+    return vol;
+}
+
+namespace morphology_detail
+{
+    template <typename E> struct max_op
+    {
+        static constexpr E identity = std::numeric_limits<E>::lowest();
+        E operator()(E a, E b) const { return a > b ? a : b; }
+    };
+    template <typename E> struct min_op
+    {
+        static constexpr E identity = std::numeric_limits<E>::max();
+        E operator()(E a, E b) const { return a < b ? a : b; }
+    };
+    struct or_op
+    {
+        static constexpr uint64_t identity = 0;
+        uint64_t operator()(uint64_t a, uint64_t b) const { return a | b; }
+    };
+    struct and_op
+    {
+        static constexpr uint64_t identity = ~uint64_t(0);
+        uint64_t operator()(uint64_t a, uint64_t b) const { return a & b; }
+    };
+
+    // van Herk / Gil-Werman 滑动窗口极值, 每个输出只需 3 次 op, 与半径无关
+    // 对 n 个位置做窗口 [i - r, i + r] 的归约, 每个位置是 length 个独立元素 (一整行), 行内逐元素计算以便向量化
+    // 超出 [0, n) 的位置视为 Op::identity, 先读完整个输入再写输出, in 与 out 可以相同
+    template <typename E, typename Op> struct running_extreme
+    {
+        std::vector<E> prefix;
+        std::vector<E> suffix;
+
+        void operator()(const E* in, size_t in_stride, E* out, size_t out_stride, int n, int length, int r)
+        {
+            Op op;
+            int w = 2 * r + 1;
+            int total = (n + 2 * r + w - 1) / w * w;
+            prefix.resize(static_cast<size_t>(total) * length);
+            suffix.resize(static_cast<size_t>(total) * length);
+            // 填充后的第 j 个位置对应输入的第 j - r 个位置
+            auto source = [&](int j) -> const E* { return j - r >= 0 && j - r < n ? in + static_cast<size_t>(j - r) * in_stride : nullptr; };
+            auto combine = [&](E* dst, const E* prev, const E* src) {
+                if (src == nullptr)
+                    std::copy_n(prev, length, dst);
+                else
+                    for (int k = 0; k < length; ++k)
+                        dst[k] = op(prev[k], src[k]);
+            };
+            auto assign = [&](E* dst, const E* src) {
+                if (src == nullptr)
+                    std::fill_n(dst, length, Op::identity);
+                else
+                    std::copy_n(src, length, dst);
+            };
+            for (int start = 0; start < total; start += w)
+            {
+                assign(&prefix[static_cast<size_t>(start) * length], source(start));
+                for (int j = start + 1; j < start + w; ++j)
+                    combine(&prefix[static_cast<size_t>(j) * length], &prefix[static_cast<size_t>(j - 1) * length], source(j));
+                int last = start + w - 1;
+                assign(&suffix[static_cast<size_t>(last) * length], source(last));
+                for (int j = last - 1; j >= start; --j)
+                    combine(&suffix[static_cast<size_t>(j) * length], &suffix[static_cast<size_t>(j + 1) * length], source(j));
+            }
+            for (int i = 0; i < n; ++i)
+            {
+                const E* s = &suffix[static_cast<size_t>(i) * length];
+                const E* p = &prefix[static_cast<size_t>(i + w - 1) * length];
+                E* dst = out + static_cast<size_t>(i) * out_stride;
+                for (int k = 0; k < length; ++k)
+                    dst[k] = op(s[k], p[k]);
+            }
+        }
+    };
+
+    // y, z 两个方向: 把整行作为一个元素, 两种体数据共用
+    // row(y, z) 返回第 (y, z) 行的首地址, 行内有 length 个元素
+    template <typename E, typename Op, typename Row> static inline void separable_yz(Row&& row, glm::ivec3 size, int length, glm::ivec3 radius)
+    {
+        size_t row_stride = static_cast<size_t>(length);
+        size_t slice_stride = row_stride * size.y;
+        if (radius.y > 0)
+            parallel_for(0, static_cast<size_t>(size.z), 1, [&](size_t begin, size_t end) {
+                running_extreme<E, Op> pass;
+                for (size_t z = begin; z < end; ++z)
+                {
+                    E* slice = row(0, static_cast<int>(z));
+                    pass(slice, row_stride, slice, row_stride, size.y, length, radius.y);
+                }
+            });
+        if (radius.z > 0)
+            parallel_for(0, static_cast<size_t>(size.y), 1, [&](size_t begin, size_t end) {
+                running_extreme<E, Op> pass;
+                for (size_t y = begin; y < end; ++y)
+                {
+                    E* line = row(static_cast<int>(y), 0);
+                    pass(line, slice_stride, line, slice_stride, size.z, length, radius.z);
+                }
+            });
+    }
+
+    template <typename T, typename Op> static inline void box_extreme(voxel<T>& vol, glm::ivec3 radius)
+    {
+        glm::ivec3 size = vol.size;
+        if (radius.x > 0)
+            parallel_for(0, static_cast<size_t>(size.y) * size.z, 16, [&](size_t begin, size_t end) {
+                running_extreme<T, Op> pass;
+                for (size_t r = begin; r < end; ++r)
+                {
+                    T* line = &vol(0, static_cast<int>(r % size.y), static_cast<int>(r / size.y));
+                    pass(line, 1, line, 1, size.x, 1, radius.x);
+                }
+            });
+        separable_yz<T, Op>([&](int y, int z) { return &vol(0, y, z); }, size, size.x, radius);
+    }
+
+    // 源行中从第 first 位开始的 64 位, 超出 [0, bits) 的位取 fill
+    static inline uint64_t read_bits(const uint64_t* src, int words, int bits, int first, uint64_t fill)
+    {
+        auto word = [&](int j) -> uint64_t {
+            if (j < 0 || j >= words)
+                return fill;
+            int valid = std::min(64, bits - j * 64);
+            if (valid >= 64)
+                return src[j];
+            uint64_t keep = (uint64_t(1) << valid) - 1;
+            return (src[j] & keep) | (fill & ~keep);
+        };
+        int q = first >= 0 ? first / 64 : -((-first + 63) / 64);
+        int shift = first - q * 64;
+        uint64_t lo = word(q);
+        return shift == 0 ? lo : (lo >> shift) | (word(q + 1) << (64 - shift));
+    }
+
+    // 打包行的 x 方向: 在左右各扩展 r 位的行上用倍增移位求 2r + 1 宽窗口的归约, 代价 O(log r) 次整行移位
+    template <typename Op> struct packed_row_pass
+    {
+        std::vector<uint64_t> current;
+        std::vector<uint64_t> shifted;
+
+        void operator()(uint64_t* row, int bits, int r)
+        {
+            Op op;
+            int words = (bits + 63) / 64;
+            int padded_bits = bits + 2 * r;
+            int padded_words = (padded_bits + 63) / 64;
+            current.resize(padded_words);
+            shifted.resize(padded_words);
+            // 扩展行的第 j 位为原行的第 j - r 位
+            for (int w = 0; w < padded_words; ++w)
+                current[w] = read_bits(row, words, bits, w * 64 - r, Op::identity);
+            auto combine_shifted = [&](int k) {
+                for (int w = 0; w < padded_words; ++w)
+                    shifted[w] = read_bits(current.data(), padded_words, padded_bits, w * 64 + k, Op::identity);
+                for (int w = 0; w < padded_words; ++w)
+                    current[w] = op(current[w], shifted[w]);
+            };
+            int window = 2 * r + 1;
+            int span = 1;
+            while (span * 2 <= window)
+            {
+                combine_shifted(span);
+                span *= 2;
+            }
+            if (span < window)
+                combine_shifted(window - span);
+            // current 的第 i 位覆盖原行 [i - r, i + r], 行尾多余的位清零
+            for (int w = 0; w < words; ++w)
+                row[w] = current[w];
+            if (bits % 64 != 0)
+                row[words - 1] &= (uint64_t(1) << (bits % 64)) - 1;
+        }
+    };
+
+    template <typename Op> static inline void box_extreme(packed_mask& mask, glm::ivec3 radius)
+    {
+        glm::ivec3 size = mask.size;
+        if (radius.x > 0)
+            parallel_for(0, static_cast<size_t>(size.y) * size.z, 16, [&](size_t begin, size_t end) {
+                packed_row_pass<Op> pass;
+                for (size_t r = begin; r < end; ++r)
+                    pass(mask.row(static_cast<int>(r % size.y), static_cast<int>(r / size.y)), size.x, radius.x);
+            });
+        // y, z 方向按字做与 / 或, 行尾多余的位在两种运算下都保持为 0
+        separable_yz<uint64_t, Op>([&](int y, int z) { return mask.row(y, z); }, size, mask.row_words, radius);
+    }
+
+    template <typename V, typename Dilate, typename Erode> static inline void apply(V& vol, morphology_op op, glm::ivec3 radius, Dilate&& dilate, Erode&& erode)
+    {
+        switch (op)
+        {
+            case morphology_op::dilate: dilate(vol, radius); break;
+            case morphology_op::erode: erode(vol, radius); break;
+            case morphology_op::open:
+                erode(vol, radius);
+                dilate(vol, radius);
+                break;
+            case morphology_op::close:
+                dilate(vol, radius);
+                erode(vol, radius);
+                break;
+        }
+    }
+} // namespace morphology_detail
+
+// 灰度 / 标签体的长方体结构元形态学, 结构元为 (2 * radius + 1) 的长方体, 体外的体素不参与计算
+// 沿 x, y, z 分三次一维滑动极值, 每体素代价与半径无关; x 按行, y 按 z 层, z 按 y 行分给各线程
+template <typename T> static inline voxel<T> morphology(volume_view<const T> vol, morphology_op op, glm::ivec3 radius)
+{
+    using namespace morphology_detail;
+    voxel<T> result = make_voxel<T>(vol.size);
+    std::copy(vol.memory.begin(), vol.memory.end(), result.memory.begin());
+    radius = glm::max(radius, glm::ivec3(0));
+    apply(result, op, radius, [](voxel<T>& v, glm::ivec3 r) { box_extreme<T, max_op<T>>(v, r); }, [](voxel<T>& v, glm::ivec3 r) { box_extreme<T, min_op<T>>(v, r); });
+    return result;
+}
+template <typename T> static inline voxel<T> morphology(const voxel<T>& vol, morphology_op op, glm::ivec3 radius)
+{
+    return morphology(as_view(vol), op, radius);
+}
+
+// 二值体: x 方向用整字移位, y / z 方向每次处理 64 个体素
+static inline packed_mask morphology(const packed_mask& mask, morphology_op op, glm::ivec3 radius)
+{
+    using namespace morphology_detail;
+    packed_mask result = mask;
+    radius = glm::max(radius, glm::ivec3(0));
+    apply(result, op, radius, [](packed_mask& m, glm::ivec3 r) { box_extreme<or_op>(m, r); }, [](packed_mask& m, glm::ivec3 r) { box_extreme<and_op>(m, r); });
+    return result;
+}
+
+struct morphology_throughput
+{
+    std::string name;
+    double seconds = 0.0;
+    double voxels_per_second = 0.0;
+};
+
+// 每种运算在 vol 上重复 repeat 次, 按平均耗时给出每秒处理的体素数
+static inline std::vector<morphology_throughput> benchmark_morphology(volume_view<const uint8_t> vol, glm::ivec3 radius, int repeat = 3)
+{
+    std::vector<morphology_throughput> results;
+    double voxels = static_cast<double>(vol.size.x) * vol.size.y * vol.size.z;
+    repeat = std::max(repeat, 1);
+    auto measure = [&](std::string name, auto&& func) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; ++i)
+            func();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / repeat;
+        results.push_back({ std::move(name), seconds, seconds > 0.0 ? voxels / seconds : 0.0 });
+    };
+    measure("gray dilate", [&] { morphology(vol, morphology_op::dilate, radius); });
+    measure("gray erode", [&] { morphology(vol, morphology_op::erode, radius); });
+    measure("gray open", [&] { morphology(vol, morphology_op::open, radius); });
+    packed_mask mask = pack_mask(vol);
+    measure("pack", [&] { pack_mask(vol); });
+    measure("packed dilate", [&] { morphology(mask, morphology_op::dilate, radius); });
+    measure("packed erode", [&] { morphology(mask, morphology_op::erode, radius); });
+    measure("packed open", [&] { morphology(mask, morphology_op::open, radius); });
+    return results;
+}
+static inline std::vector<morphology_throughput> benchmark_morphology(const voxel<uint8_t>& vol, glm::ivec3 radius, int repeat = 3)
+{
+    return benchmark_morphology(as_view(vol), radius, repeat);
+}
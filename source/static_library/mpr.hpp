@@ -0,0 +1,274 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/bricked_voxel.hpp"
+#include "interface/pixel.hpp"
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+enum class slab_mode
+{
+    mip,
+    average,
+};
+
+// 重采样平面, 坐标以体素为单位, 体素中心位于整数坐标
+// 像素 (i, j) 位于 origin + u * i + v * j, thickness > 0 时沿法线 cross(u, v) 方向做厚层合成
+struct mpr_plane
+{
+    glm::vec3 origin{ 0.0f };
+    glm::vec3 u{ 1.0f, 0.0f, 0.0f };
+    glm::vec3 v{ 0.0f, 1.0f, 0.0f };
+    glm::ivec2 size{ 0 };
+    float thickness = 0.0f;
+    int slab_samples = 0; // 0 时按每体素一个采样点
+    slab_mode mode = slab_mode::mip;
+
+    glm::vec3 normal() const { return glm::normalize(glm::cross(u, v)); }
+};
+
+// 垂直于 axis 的切片, slice 为 [0, 1] 的相对位置
+static inline mpr_plane make_axis_plane(glm::ivec3 size, int axis, float slice)
+{
+    mpr_plane plane;
+    axis = std::clamp(axis, 0, 2);
+    int a = axis == 0 ? 1 : 0;
+    int b = axis == 2 ? 1 : 2;
+    plane.u = glm::vec3(0.0f);
+    plane.v = glm::vec3(0.0f);
+    plane.u[a] = 1.0f;
+    plane.v[b] = 1.0f;
+    plane.origin[axis] = std::clamp(slice, 0.0f, 1.0f) * static_cast<float>(std::max(size[axis] - 1, 0));
+    plane.size = { size[a], size[b] };
+    return plane;
+}
+
+// 过 center 且法线为 normal 的斜切面, 每像素 spacing 个体素, 输出图像中心对准 center
+static inline mpr_plane make_oblique_plane(glm::vec3 center, glm::vec3 normal, glm::ivec2 size, float spacing = 1.0f)
+{
+    mpr_plane plane;
+    normal = glm::normalize(normal);
+    glm::vec3 helper = std::abs(normal.y) < 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+    plane.u = glm::normalize(glm::cross(helper, normal)) * spacing;
+    plane.v = glm::normalize(glm::cross(normal, plane.u)) * spacing;
+    plane.size = size;
+    plane.origin = center - plane.u * (static_cast<float>(size.x - 1) * 0.5f) - plane.v * (static_cast<float>(size.y - 1) * 0.5f);
+    return plane;
+}
+
+namespace mpr_detail
+{
+    template <typename R> static inline R store(float value)
+    {
+        if constexpr (std::is_integral_v<R>)
+            return static_cast<R>(std::clamp(std::round(value), static_cast<float>(std::numeric_limits<R>::lowest()), static_cast<float>(std::numeric_limits<R>::max())));
+        else
+            return static_cast<R>(value);
+    }
+
+    constexpr int packet_size = 8;
+
+    // 按坐标读取体素值的访问器, 连续体数据直接计算偏移, 分块体数据经砖块索引
+    template <typename T> static inline auto fetch_of(volume_view<const T> vol)
+    {
+        const T* data = vol.memory.data();
+        size_t stride_y = static_cast<size_t>(vol.size.x);
+        size_t stride_z = stride_y * static_cast<size_t>(vol.size.y);
+        return [=](int x, int y, int z) { return static_cast<float>(data[static_cast<size_t>(z) * stride_z + static_cast<size_t>(y) * stride_y + static_cast<size_t>(x)]); };
+    }
+    template <typename T, int N> static inline auto fetch_of(const bricked_voxel<T, N>& vol)
+    {
+        return [&vol](int x, int y, int z) { return static_cast<float>(vol(x, y, z)); };
+    }
+
+    // 一行上 count 个等距点 p + step * i 的三线性插值, 超出 [-0.5, size - 0.5] 时为 0, 边缘半个体素按钳制处理
+    // 每 packet_size 个点一组按分量 (SoA) 计算: 先求各通道的权重和角点坐标, 再逐通道收集 8 个角点, 最后统一插值并按掩码置 0
+    // 除收集外的循环都没有分支, 可以被编译器向量化
+    template <typename Volume> static inline void sample_row(const Volume& vol, glm::vec3 p, glm::vec3 step, int count, float* out)
+    {
+        if (vol.memory.empty())
+        {
+            std::fill_n(out, count, 0.0f);
+            return;
+        }
+        const glm::vec3 hi = glm::vec3(vol.size) - 0.5f;
+        const glm::vec3 top = glm::vec3(vol.size - 1);
+        auto fetch = fetch_of(vol);
+        for (int first = 0; first < count; first += packet_size)
+        {
+            alignas(32) float fx[packet_size], fy[packet_size], fz[packet_size];
+            alignas(32) int inside[packet_size];
+            alignas(32) int x0[packet_size], y0[packet_size], z0[packet_size], x1[packet_size], y1[packet_size], z1[packet_size];
+            for (int l = 0; l < packet_size; ++l)
+            {
+                float t = static_cast<float>(first + l);
+                float x = p.x + step.x * t, y = p.y + step.y * t, z = p.z + step.z * t;
+                inside[l] = x >= -0.5f && y >= -0.5f && z >= -0.5f && x <= hi.x && y <= hi.y && z <= hi.z;
+                x = std::clamp(x, 0.0f, top.x);
+                y = std::clamp(y, 0.0f, top.y);
+                z = std::clamp(z, 0.0f, top.z);
+                x0[l] = static_cast<int>(x), y0[l] = static_cast<int>(y), z0[l] = static_cast<int>(z);
+                fx[l] = x - static_cast<float>(x0[l]);
+                fy[l] = y - static_cast<float>(y0[l]);
+                fz[l] = z - static_cast<float>(z0[l]);
+                x1[l] = std::min(x0[l] + 1, vol.size.x - 1);
+                y1[l] = std::min(y0[l] + 1, vol.size.y - 1);
+                z1[l] = std::min(z0[l] + 1, vol.size.z - 1);
+            }
+            // c[k][l]: 通道 l 的第 k 个角点, k 的第 0, 1, 2 位分别为 x, y, z 方向的偏移
+            alignas(32) float c[8][packet_size];
+            for (int l = 0; l < packet_size; ++l)
+                for (int k = 0; k < 8; ++k)
+                    c[k][l] = fetch(k & 1 ? x1[l] : x0[l], k & 2 ? y1[l] : y0[l], k & 4 ? z1[l] : z0[l]);
+            alignas(32) float result[packet_size];
+            for (int l = 0; l < packet_size; ++l)
+            {
+                float c00 = c[0][l] + (c[1][l] - c[0][l]) * fx[l];
+                float c10 = c[2][l] + (c[3][l] - c[2][l]) * fx[l];
+                float c01 = c[4][l] + (c[5][l] - c[4][l]) * fx[l];
+                float c11 = c[6][l] + (c[7][l] - c[6][l]) * fx[l];
+                float c0 = c00 + (c10 - c00) * fy[l];
+                float c1 = c01 + (c11 - c01) * fy[l];
+                result[l] = inside[l] ? c0 + (c1 - c0) * fz[l] : 0.0f;
+            }
+            std::copy_n(result, std::min(packet_size, count - first), out + first);
+        }
+    }
+
+    // 单位轴向步进且行列对齐体素的单层平面: 只需在两层之间线性插值
+    static inline bool axis_aligned(const mpr_plane& plane, int& axis_u, int& axis_v, int& axis_n)
+    {
+        if (plane.thickness > 0.0f)
+            return false;
+        auto unit_axis = [](glm::vec3 d) {
+            for (int k = 0; k < 3; ++k)
+                if (d[k] == 1.0f && d[(k + 1) % 3] == 0.0f && d[(k + 2) % 3] == 0.0f)
+                    return k;
+            return -1;
+        };
+        axis_u = unit_axis(plane.u);
+        axis_v = unit_axis(plane.v);
+        if (axis_u < 0 || axis_v < 0 || axis_u == axis_v)
+            return false;
+        axis_n = 3 - axis_u - axis_v;
+        return plane.origin[axis_u] == std::floor(plane.origin[axis_u]) && plane.origin[axis_v] == std::floor(plane.origin[axis_v]);
+    }
+
+    // Volume 为 volume_view<const T> 或 bricked_voxel<T, N>, 两者都提供 size, memory 和 operator()(x, y, z)
+    template <typename R, typename Volume> static inline void reslice_row(const Volume& vol, const mpr_plane& plane, int row, R* out)
+    {
+        int axis_u, axis_v, axis_n;
+        if (axis_aligned(plane, axis_u, axis_v, axis_n))
+        {
+            float n = plane.origin[axis_n];
+            if (n < -0.5f || n > static_cast<float>(vol.size[axis_n]) - 0.5f)
+            {
+                std::fill_n(out, plane.size.x, store<R>(0.0f));
+                return;
+            }
+            n = std::clamp(n, 0.0f, static_cast<float>(vol.size[axis_n] - 1));
+            int n0 = static_cast<int>(n);
+            int n1 = std::min(n0 + 1, vol.size[axis_n] - 1);
+            float f = n - static_cast<float>(n0);
+            glm::ivec3 c0{ 0 }, c1{ 0 };
+            c0[axis_v] = c1[axis_v] = static_cast<int>(plane.origin[axis_v]) + row;
+            c0[axis_n] = n0;
+            c1[axis_n] = n1;
+            int start = static_cast<int>(plane.origin[axis_u]);
+            for (int i = 0; i < plane.size.x; ++i)
+            {
+                int x = start + i;
+                c0[axis_u] = c1[axis_u] = x;
+                bool inside = x >= 0 && x < vol.size[axis_u] && c0[axis_v] >= 0 && c0[axis_v] < vol.size[axis_v];
+                float a = inside ? static_cast<float>(vol(c0.x, c0.y, c0.z)) : 0.0f;
+                float b = inside ? static_cast<float>(vol(c1.x, c1.y, c1.z)) : 0.0f;
+                out[i] = store<R>(a + (b - a) * f);
+            }
+            return;
+        }
+
+        glm::vec3 p = plane.origin + plane.v * static_cast<float>(row);
+        std::vector<float> values(static_cast<size_t>(std::max(plane.size.x, 0)));
+        if (plane.thickness <= 0.0f)
+        {
+            sample_row(vol, p, plane.u, plane.size.x, values.data());
+            for (int i = 0; i < plane.size.x; ++i)
+                out[i] = store<R>(values[i]);
+            return;
+        }
+
+        // 厚层按层批量采样整行, 再逐像素合成
+        int samples = plane.slab_samples > 0 ? plane.slab_samples : std::max(2, static_cast<int>(std::ceil(plane.thickness)) + 1);
+        glm::vec3 step = plane.normal() * (plane.thickness / static_cast<float>(samples - 1));
+        glm::vec3 first = -plane.normal() * (plane.thickness * 0.5f);
+        std::vector<float> acc(values.size(), plane.mode == slab_mode::mip ? -std::numeric_limits<float>::infinity() : 0.0f);
+        for (int k = 0; k < samples; ++k)
+        {
+            sample_row(vol, p + first + step * static_cast<float>(k), plane.u, plane.size.x, values.data());
+            if (plane.mode == slab_mode::mip)
+                for (size_t i = 0; i < acc.size(); ++i)
+                    acc[i] = std::max(acc[i], values[i]);
+            else
+                for (size_t i = 0; i < acc.size(); ++i)
+                    acc[i] += values[i];
+        }
+        for (int i = 0; i < plane.size.x; ++i)
+            out[i] = store<R>(plane.mode == slab_mode::mip ? acc[i] : acc[i] / static_cast<float>(samples));
+    }
+
+    // 同时重采样多个平面, 所有平面的所有行一起在线程间分配
+    template <typename R, typename Volume> static inline std::vector<pixel<R>> reslice_planes(const Volume& vol, std::span<const mpr_plane> planes)
+    {
+        std::vector<pixel<R>> images;
+        std::vector<size_t> first_row;
+        size_t rows = 0;
+        for (const auto& plane : planes)
+        {
+            images.push_back(make_pixel<R>(plane.size));
+            first_row.push_back(rows);
+            rows += static_cast<size_t>(std::max(plane.size.y, 0));
+        }
+        parallel_for(0, rows, 8, [&](size_t begin, size_t end) {
+            for (size_t row = begin; row < end; ++row)
+            {
+                size_t index = static_cast<size_t>(std::upper_bound(first_row.begin(), first_row.end(), row) - first_row.begin()) - 1;
+                int y = static_cast<int>(row - first_row[index]);
+                reslice_row(vol, planes[index], y, &images[index](0, y));
+            }
+        });
+        return images;
+    }
+} // namespace mpr_detail
+
+template <typename R = void, typename T> static inline auto reslice(volume_view<const T> vol, std::span<const mpr_plane> planes)
+{
+    return mpr_detail::reslice_planes<std::conditional_t<std::is_void_v<R>, T, R>>(vol, planes);
+}
+template <typename R = void, typename T> static inline auto reslice(volume_view<const T> vol, const mpr_plane& plane)
+{
+    return std::move(reslice<R>(vol, std::span<const mpr_plane>(&plane, 1)).front());
+}
+template <typename R = void, typename T> static inline auto reslice(const voxel<T>& vol, std::span<const mpr_plane> planes)
+{
+    return reslice<R>(as_view(vol), planes);
+}
+template <typename R = void, typename T> static inline auto reslice(const voxel<T>& vol, const mpr_plane& plane)
+{
+    return reslice<R>(as_view(vol), plane);
+}
+// 分块体数据直接重采样, 斜切面上相邻像素的角点多落在同一砖块内
+template <typename R = void, typename T, int N> static inline auto reslice(const bricked_voxel<T, N>& vol, std::span<const mpr_plane> planes)
+{
+    return mpr_detail::reslice_planes<std::conditional_t<std::is_void_v<R>, T, R>>(vol, planes);
+}
+template <typename R = void, typename T, int N> static inline auto reslice(const bricked_voxel<T, N>& vol, const mpr_plane& plane)
+{
+    return std::move(reslice<R>(vol, std::span<const mpr_plane>(&plane, 1)).front());
+}
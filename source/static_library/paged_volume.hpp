@@ -0,0 +1,319 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <expected>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "volume_file.hpp"
+
+struct brick_cache_statistics
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t prefetch_requests = 0;
+    uint64_t prefetch_loads = 0;
+    size_t resident_bricks = 0;
+    size_t capacity_bricks = 0;
+
+    double hit_rate() const { return hits + misses == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses); }
+};
+
+// 超出内存的体数据: 从原生体数据文件按需加载砖块到固定容量的 LRU 缓存
+// pin 返回的 brick_handle 存活期间砖块不会被淘汰, 后台线程按访问方向异步预取
+template <typename T> class paged_volume
+{
+    struct entry
+    {
+        std::vector<T> memory;
+        bool ready = false;
+        bool failed = false;
+    };
+    struct slot
+    {
+        std::shared_ptr<entry> data;
+        std::list<size_t>::iterator lru;
+    };
+
+public:
+    class brick_handle
+    {
+    public:
+        brick_handle() = default;
+
+        explicit operator bool() const { return data != nullptr && data->ready && not data->failed; }
+
+        glm::ivec3 origin{ 0 };
+        glm::ivec3 extent{ 0 };
+
+        std::span<const T> memory() const { return data ? std::span<const T>(data->memory) : std::span<const T>(); }
+        // 砖块内局部坐标
+        const T& operator()(int x, int y, int z) const { return data->memory[(static_cast<size_t>(z) * extent.y + y) * extent.x + x]; }
+
+    private:
+        friend class paged_volume;
+        std::shared_ptr<const entry> data;
+    };
+
+    static std::expected<std::shared_ptr<paged_volume>, std::string> open(const std::filesystem::path& file, size_t cache_bytes)
+    {
+        auto reader_ret = volume_file_reader::open(file);
+        if (not reader_ret.has_value())
+            return std::unexpected(reader_ret.error());
+        if (reader_ret.value()->header().type != raw_voxel_type_of<T>())
+            return std::unexpected(fmt::format("{}: voxel type mismatch", file));
+        return std::make_shared<paged_volume>(reader_ret.value(), cache_bytes);
+    }
+
+    paged_volume(std::shared_ptr<volume_file_reader> reader, size_t cache_bytes) : reader(std::move(reader))
+    {
+        const auto& header = this->reader->header();
+        size_t brick_bytes = static_cast<size_t>(header.brick_size) * header.brick_size * header.brick_size * sizeof(T);
+        capacity = std::max<size_t>(1, cache_bytes / std::max<size_t>(brick_bytes, 1));
+        prefetch_thread = std::jthread([this](std::stop_token token) { prefetch_loop(token); });
+    }
+    ~paged_volume()
+    {
+        {
+            std::lock_guard lock(prefetch_mutex);
+            prefetch_thread.request_stop();
+        }
+        prefetch_signal.notify_all();
+    }
+
+    paged_volume(const paged_volume&) = delete;
+    paged_volume& operator=(const paged_volume&) = delete;
+
+    const volume_file_header& header() const { return reader->header(); }
+    glm::ivec3 size() const { return reader->header().size; }
+
+    // 阻塞加载并固定砖块
+    brick_handle pin(size_t index)
+    {
+        brick_handle handle;
+        if (index >= reader->bricks().size())
+            return handle;
+        handle.origin = header().brick_origin(index);
+        handle.extent = header().brick_extent(index);
+        handle.data = acquire(index, false);
+        track_access(index);
+        return handle;
+    }
+    brick_handle pin(glm::ivec3 brick) { return pin(header().brick_index(brick)); }
+    brick_handle pin_voxel(int x, int y, int z) { return pin(glm::ivec3(x, y, z) / header().brick_size); }
+
+    // 单个体素的便捷访问, 每次都会查询缓存; 批量访问应使用 pin
+    T at(int x, int y, int z)
+    {
+        auto handle = pin_voxel(x, y, z);
+        if (not handle)
+            return T{};
+        return handle(x - handle.origin.x, y - handle.origin.y, z - handle.origin.z);
+    }
+
+    // 异步预取, 已在缓存中的砖块会被忽略
+    void prefetch(std::span<const size_t> indices)
+    {
+        {
+            std::lock_guard lock(prefetch_mutex);
+            for (size_t index : indices)
+                if (index < reader->bricks().size())
+                    prefetch_queue.push_back(index);
+        }
+        prefetch_requests += indices.size();
+        prefetch_signal.notify_one();
+    }
+    // 预取从 origin (体素坐标) 沿 direction 前进 distance 个体素经过的砖块
+    void prefetch_along(glm::vec3 origin, glm::vec3 direction, float distance)
+    {
+        if (glm::length(direction) <= 0.0f)
+            return;
+        direction = glm::normalize(direction);
+        float step = static_cast<float>(header().brick_size) * 0.5f;
+        glm::ivec3 grid = header().brick_grid();
+        std::vector<size_t> indices;
+        size_t last = static_cast<size_t>(-1);
+        for (float t = 0.0f; t <= distance; t += step)
+        {
+            glm::ivec3 brick = glm::ivec3(glm::floor((origin + direction * t) / static_cast<float>(header().brick_size)));
+            if (glm::any(glm::lessThan(brick, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(brick, grid)))
+                continue;
+            size_t index = header().brick_index(brick);
+            if (index != last)
+                indices.push_back(index);
+            last = index;
+        }
+        prefetch(indices);
+    }
+
+    brick_cache_statistics statistics() const
+    {
+        brick_cache_statistics stats;
+        stats.hits = hits;
+        stats.misses = misses;
+        stats.evictions = evictions;
+        stats.prefetch_requests = prefetch_requests;
+        stats.prefetch_loads = prefetch_loads;
+        stats.capacity_bricks = capacity;
+        std::lock_guard lock(cache_mutex);
+        stats.resident_bricks = slots.size();
+        return stats;
+    }
+    void reset_statistics()
+    {
+        hits = misses = evictions = prefetch_requests = prefetch_loads = 0;
+    }
+
+    // 连续访问时沿访问方向预取的砖块数, 0 关闭自动预取
+    std::atomic<int> prefetch_depth = 2;
+
+private:
+    std::shared_ptr<entry> acquire(size_t index, bool from_prefetch)
+    {
+        std::shared_ptr<entry> data;
+        bool need_load = false;
+        {
+            std::unique_lock lock(cache_mutex);
+            if (auto it = slots.find(index); it != slots.end())
+            {
+                lru.splice(lru.begin(), lru, it->second.lru);
+                data = it->second.data;
+                if (not from_prefetch)
+                    ++hits;
+                loaded.wait(lock, [&]() { return data->ready; });
+                return data;
+            }
+            if (from_prefetch)
+                ++prefetch_loads;
+            else
+                ++misses;
+            evict_locked();
+            data = std::make_shared<entry>();
+            lru.push_front(index);
+            slots.emplace(index, slot{ data, lru.begin() });
+            need_load = true;
+        }
+
+        // 解压在锁外进行, 其他线程请求同一砖块时等待 ready
+        if (need_load)
+        {
+            glm::ivec3 ext = header().brick_extent(index);
+            data->memory.resize(static_cast<size_t>(ext.x) * ext.y * ext.z);
+            bool ok = reader->read_brick<T>(index, data->memory);
+            if (not ok)
+                SPDLOG_ERROR("{}: failed to read brick {}", reader->path(), index);
+            {
+                std::lock_guard lock(cache_mutex);
+                data->failed = not ok;
+                data->ready = true;
+                // 读取失败的砖块不留在缓存中, 之后的访问会重新读取; 正在等待的线程仍拿到这次失败的结果
+                if (auto it = slots.find(index); not ok && it != slots.end() && it->second.data == data)
+                {
+                    lru.erase(it->second.lru);
+                    slots.erase(it);
+                }
+            }
+            loaded.notify_all();
+        }
+        return data;
+    }
+
+    // 淘汰最久未使用且未被固定的砖块; 全部被固定时允许暂时超出容量
+    void evict_locked()
+    {
+        for (auto it = lru.end(); slots.size() >= capacity && it != lru.begin();)
+        {
+            --it;
+            auto slot_it = slots.find(*it);
+            // 只有缓存自己持有时才能淘汰 (handle 只在持锁时创建)
+            if (slot_it->second.data.use_count() == 1 && slot_it->second.data->ready)
+            {
+                slots.erase(slot_it);
+                it = lru.erase(it);
+                ++evictions;
+            }
+        }
+    }
+
+    // 记录最近两次访问的砖块, 方向一致时沿该方向预取
+    void track_access(size_t index)
+    {
+        int depth = prefetch_depth;
+        size_t previous = last_brick.exchange(index);
+        if (depth <= 0 || previous == index || previous >= reader->bricks().size())
+            return;
+        glm::ivec3 current = header().brick_coord(index);
+        glm::ivec3 delta = current - header().brick_coord(previous);
+        if (glm::any(glm::greaterThan(glm::abs(delta), glm::ivec3(1))))
+            return;
+
+        glm::ivec3 grid = header().brick_grid();
+        std::vector<size_t> indices;
+        for (int i = 1; i <= depth; ++i)
+        {
+            glm::ivec3 next = current + delta * i;
+            if (glm::any(glm::lessThan(next, glm::ivec3(0))) || glm::any(glm::greaterThanEqual(next, grid)))
+                break;
+            indices.push_back(header().brick_index(next));
+        }
+        if (not indices.empty())
+            prefetch(indices);
+    }
+
+    void prefetch_loop(std::stop_token token)
+    {
+        while (not token.stop_requested())
+        {
+            size_t index;
+            {
+                std::unique_lock lock(prefetch_mutex);
+                prefetch_signal.wait(lock, [&]() { return token.stop_requested() || not prefetch_queue.empty(); });
+                if (token.stop_requested())
+                    return;
+                index = prefetch_queue.front();
+                prefetch_queue.pop_front();
+            }
+            {
+                std::lock_guard lock(cache_mutex);
+                if (slots.contains(index))
+                    continue;
+            }
+            acquire(index, true);
+        }
+    }
+
+    std::shared_ptr<volume_file_reader> reader;
+    size_t capacity = 1;
+
+    mutable std::mutex cache_mutex;
+    std::condition_variable loaded;
+    std::list<size_t> lru;
+    std::unordered_map<size_t, slot> slots;
+
+    std::atomic<size_t> last_brick = static_cast<size_t>(-1);
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> evictions = 0;
+    std::atomic<uint64_t> prefetch_requests = 0;
+    std::atomic<uint64_t> prefetch_loads = 0;
+
+    std::mutex prefetch_mutex;
+    std::condition_variable prefetch_signal;
+    std::deque<size_t> prefetch_queue;
+    std::jthread prefetch_thread;
+};
+
@@ -0,0 +1,64 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static inline size_t parallel_worker_count()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// 把 [begin, end) 按 grain 切块, 在所有核心上动态调度执行 func(chunk_begin, chunk_end)
+// 调用线程也参与计算, 返回时所有块都已完成
+template <typename Func> static inline void parallel_for(size_t begin, size_t end, size_t grain, Func&& func)
+{
+    if (end <= begin)
+        return;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (end - begin + grain - 1) / grain;
+    size_t workers = std::min(chunks, parallel_worker_count());
+    if (workers <= 1)
+        return func(begin, end);
+
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&]() {
+        for (size_t chunk = next.fetch_add(1); chunk < chunks; chunk = next.fetch_add(1))
+        {
+            size_t chunk_begin = begin + chunk * grain;
+            func(chunk_begin, std::min(end, chunk_begin + grain));
+        }
+    };
+    std::vector<std::jthread> threads;
+    threads.reserve(workers - 1);
+    for (size_t i = 1; i < workers; ++i)
+        threads.emplace_back(worker);
+    worker();
+}
+
+// 与 parallel_for 相同, 额外传入工作线程序号 func(worker, chunk_begin, chunk_end), worker < parallel_worker_count()
+// 用于每线程私有的累加缓冲区, 结束后由调用方合并
+template <typename Func> static inline void parallel_for_workers(size_t begin, size_t end, size_t grain, Func&& func)
+{
+    if (end <= begin)
+        return;
+    grain = std::max<size_t>(grain, 1);
+    size_t chunks = (end - begin + grain - 1) / grain;
+    size_t workers = std::min(chunks, parallel_worker_count());
+    if (workers <= 1)
+        return func(size_t(0), begin, end);
+
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&](size_t index) {
+        for (size_t chunk = next.fetch_add(1); chunk < chunks; chunk = next.fetch_add(1))
+        {
+            size_t chunk_begin = begin + chunk * grain;
+            func(index, chunk_begin, std::min(end, chunk_begin + grain));
+        }
+    };
+    std::vector<std::jthread> threads;
+    threads.reserve(workers - 1);
+    for (size_t i = 1; i < workers; ++i)
+        threads.emplace_back(worker, i);
+    worker(0);
+}
@@ -0,0 +1,308 @@
+#pragma once
+#include <bit>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <limits>
+#include <span>
+#include <string>
+
+#include <fmt/format.h>
+
+#include "interface/voxel.hpp"
+#include "mapped_file.hpp"
+#include "parallel_for.hpp"
+
+// raw 文件中单个体素的存储类型
+enum class raw_voxel_type
+{
+    u8,
+    i8,
+    u16,
+    i16,
+    u32,
+    i32,
+    f32,
+    f64,
+};
+
+// 文件中切片的先后顺序
+enum class raw_slice_order
+{
+    z_ascending,
+    z_descending,
+};
+
+struct raw_normalization
+{
+    enum class mode
+    {
+        none,   // 直接转换, 超出目标类型范围的值截断
+        shift,  // 左移 shift 位 (负数为右移), 例如 u8 -> u16 使用 8
+        linear, // value * scale + offset
+        range,  // 把数据实际的 [min, max] 拉伸到目标类型的完整范围 (浮点目标为 [0, 1])
+    };
+    mode type = mode::none;
+    int shift = 0;
+    double scale = 1.0;
+    double offset = 0.0;
+};
+
+struct raw_volume_descriptor
+{
+    glm::ivec3 size{ 0 };
+    raw_voxel_type type = raw_voxel_type::u16;
+    std::endian endian = std::endian::little;
+    size_t header_offset = 0;
+    raw_slice_order slice_order = raw_slice_order::z_ascending;
+    raw_normalization normalization;
+};
+
+static inline size_t raw_voxel_type_size(raw_voxel_type type)
+{
+    switch (type)
+    {
+        case raw_voxel_type::u8:
+        case raw_voxel_type::i8: return 1;
+        case raw_voxel_type::u16:
+        case raw_voxel_type::i16: return 2;
+        case raw_voxel_type::u32:
+        case raw_voxel_type::i32:
+        case raw_voxel_type::f32: return 4;
+        case raw_voxel_type::f64: return 8;
+    }
+    return 0;
+}
+
+template <typename T> static constexpr raw_voxel_type raw_voxel_type_of()
+{
+    if constexpr (std::is_same_v<T, uint8_t>)
+        return raw_voxel_type::u8;
+    else if constexpr (std::is_same_v<T, int8_t>)
+        return raw_voxel_type::i8;
+    else if constexpr (std::is_same_v<T, uint16_t>)
+        return raw_voxel_type::u16;
+    else if constexpr (std::is_same_v<T, int16_t>)
+        return raw_voxel_type::i16;
+    else if constexpr (std::is_same_v<T, uint32_t>)
+        return raw_voxel_type::u32;
+    else if constexpr (std::is_same_v<T, int32_t>)
+        return raw_voxel_type::i32;
+    else if constexpr (std::is_same_v<T, float>)
+        return raw_voxel_type::f32;
+    else if constexpr (std::is_same_v<T, double>)
+        return raw_voxel_type::f64;
+    else
+        static_assert(sizeof(T) == 0, "unsupported voxel type");
+}
+
+namespace raw_ingest_detail
+{
+    template <typename S> static inline S byte_swap(S value)
+    {
+        if constexpr (sizeof(S) == 1)
+            return value;
+        else if constexpr (std::is_floating_point_v<S>)
+        {
+            using bits_t = std::conditional_t<sizeof(S) == 4, uint32_t, uint64_t>;
+            return std::bit_cast<S>(std::byteswap(std::bit_cast<bits_t>(value)));
+        }
+        else
+            return std::byteswap(value);
+    }
+
+    // 截断到 T 的取值范围, 浮点输入四舍五入到整数; 写成无分支形式便于编译器向量化
+    // 浮点输入在 double 中舍入和截断: 32 位整数的上下限在 float 中不可精确表示 (会进位到 2^32 / 2^31), 在 double 中可以; NaN 转为 0
+    template <typename T, typename V> static inline T saturate_cast(V value)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+            return static_cast<T>(value);
+        else if constexpr (std::is_floating_point_v<V>)
+        {
+            static_assert(sizeof(T) <= 4, "integer limits must be exact in double");
+            constexpr double lo = static_cast<double>(std::numeric_limits<T>::lowest());
+            constexpr double hi = static_cast<double>(std::numeric_limits<T>::max());
+            double v = static_cast<double>(value);
+            v += v < 0.0 ? -0.5 : 0.5;
+            v = v < lo ? lo : (v > hi ? hi : v);
+            return static_cast<T>(v == v ? v : 0.0);
+        }
+        else
+        {
+            constexpr int64_t lo = static_cast<int64_t>(std::numeric_limits<T>::lowest());
+            constexpr int64_t hi = static_cast<int64_t>(std::numeric_limits<T>::max());
+            int64_t v = static_cast<int64_t>(value);
+            return static_cast<T>(v < lo ? lo : (v > hi ? hi : v));
+        }
+    }
+
+    // 小整数在 float 中可精确表示, 其余使用 double
+    template <typename S> using compute_t = std::conditional_t<(sizeof(S) <= 2 && std::is_integral_v<S>), float, double>;
+
+    // 每次处理一小段: 拷贝到栈上 (源数据可能未对齐), 字节交换, 再逐元素转换
+    template <typename S, typename T, typename Op> static inline void convert_run(const std::byte* src, T* dst, size_t count, bool swap, Op&& op)
+    {
+        constexpr size_t block = 4096 / sizeof(S);
+        alignas(64) S tmp[block];
+        for (size_t i = 0; i < count; i += block)
+        {
+            size_t n = std::min(block, count - i);
+            std::memcpy(tmp, src + i * sizeof(S), n * sizeof(S));
+            if constexpr (sizeof(S) > 1)
+                if (swap)
+                    for (size_t k = 0; k < n; ++k)
+                        tmp[k] = byte_swap(tmp[k]);
+            for (size_t k = 0; k < n; ++k)
+                dst[i + k] = op(tmp[k]);
+        }
+    }
+
+    template <typename S> static inline std::pair<double, double> value_range(std::span<const std::byte> payload, size_t count, bool swap)
+    {
+        size_t workers = parallel_worker_count();
+        std::vector<std::pair<S, S>> ranges(workers, { std::numeric_limits<S>::max(), std::numeric_limits<S>::lowest() });
+        parallel_for_workers(0, count, 1 << 20, [&](size_t worker, size_t begin, size_t end) {
+            constexpr size_t block = 4096 / sizeof(S);
+            alignas(64) S tmp[block];
+            S lo = ranges[worker].first;
+            S hi = ranges[worker].second;
+            for (size_t i = begin; i < end; i += block)
+            {
+                size_t n = std::min(block, end - i);
+                std::memcpy(tmp, payload.data() + i * sizeof(S), n * sizeof(S));
+                for (size_t k = 0; k < n; ++k)
+                {
+                    S v = swap ? byte_swap(tmp[k]) : tmp[k];
+                    lo = v < lo ? v : lo;
+                    hi = v > hi ? v : hi;
+                }
+            }
+            ranges[worker] = { lo, hi };
+        });
+        double lo = std::numeric_limits<double>::max();
+        double hi = std::numeric_limits<double>::lowest();
+        for (auto& [l, h] : ranges)
+        {
+            lo = std::min(lo, static_cast<double>(l));
+            hi = std::max(hi, static_cast<double>(h));
+        }
+        return { lo, hi };
+    }
+
+    template <typename S, typename T> static inline std::expected<void, std::string> convert(std::span<const std::byte> payload, const raw_volume_descriptor& desc, voxel<T>& vox)
+    {
+        const bool swap = sizeof(S) > 1 && desc.endian != std::endian::native;
+        const size_t slice_voxels = static_cast<size_t>(desc.size.x) * desc.size.y;
+        const size_t slice_bytes = slice_voxels * sizeof(S);
+        const size_t slices = static_cast<size_t>(desc.size.z);
+
+        // 每个任务处理若干完整切片, 约 4MB 一块
+        const size_t grain = std::max<size_t>(1, (4u << 20) / std::max<size_t>(slice_bytes, 1));
+        auto for_each_slice = [&](auto&& op) {
+            parallel_for(0, slices, grain, [&](size_t begin, size_t end) {
+                for (size_t z = begin; z < end; ++z)
+                {
+                    size_t dst_z = desc.slice_order == raw_slice_order::z_descending ? slices - 1 - z : z;
+                    convert_run<S>(payload.data() + z * slice_bytes, vox.memory.data() + dst_z * slice_voxels, slice_voxels, swap, op);
+                }
+            });
+        };
+
+        using compute = compute_t<S>;
+        switch (desc.normalization.type)
+        {
+            case raw_normalization::mode::none:
+            {
+                if constexpr (std::is_same_v<S, T>)
+                {
+                    if (not swap && desc.slice_order == raw_slice_order::z_ascending)
+                    {
+                        parallel_for(0, slices, grain, [&](size_t begin, size_t end) {
+                            std::memcpy(vox.memory.data() + begin * slice_voxels, payload.data() + begin * slice_bytes, (end - begin) * slice_bytes);
+                        });
+                        return {};
+                    }
+                }
+                for_each_slice([](S v) { return saturate_cast<T>(v); });
+                return {};
+            }
+            case raw_normalization::mode::shift:
+            {
+                if constexpr (std::is_floating_point_v<S>)
+                    return std::unexpected(std::string("shift normalization requires integer voxels"));
+                else
+                {
+                    int shift = desc.normalization.shift;
+                    if (shift >= 0)
+                        for_each_slice([shift](S v) { return saturate_cast<T>(static_cast<int64_t>(v) << shift); });
+                    else
+                        for_each_slice([shift = -shift](S v) { return saturate_cast<T>(static_cast<int64_t>(v) >> shift); });
+                    return {};
+                }
+            }
+            case raw_normalization::mode::linear:
+            {
+                compute scale = static_cast<compute>(desc.normalization.scale);
+                compute offset = static_cast<compute>(desc.normalization.offset);
+                for_each_slice([scale, offset](S v) { return saturate_cast<T>(static_cast<compute>(v) * scale + offset); });
+                return {};
+            }
+            case raw_normalization::mode::range:
+            {
+                auto [lo, hi] = value_range<S>(payload, slices * slice_voxels, swap);
+                double target = std::is_floating_point_v<T> ? 1.0 : static_cast<double>(std::numeric_limits<T>::max());
+                double target_lo = std::is_floating_point_v<T> ? 0.0 : static_cast<double>(std::numeric_limits<T>::lowest());
+                compute scale = static_cast<compute>(hi > lo ? (target - target_lo) / (hi - lo) : 0.0);
+                compute offset = static_cast<compute>(target_lo - lo * static_cast<double>(scale));
+                for_each_slice([scale, offset](S v) { return saturate_cast<T>(static_cast<compute>(v) * scale + offset); });
+                return {};
+            }
+        }
+        return std::unexpected(std::string("unknown normalization mode"));
+    }
+} // namespace raw_ingest_detail
+
+// 按描述解析 raw 数据并直接写入 voxel<T>: 按切片分块并行, 字节交换/类型转换/归一化在同一遍完成
+template <typename T> static inline std::expected<voxel<T>, std::string> ingest_raw_volume(std::span<const std::byte> bytes, const raw_volume_descriptor& desc)
+{
+    if (desc.size.x <= 0 || desc.size.y <= 0 || desc.size.z <= 0)
+        return std::unexpected(fmt::format("invalid volume size ({}, {}, {})", desc.size.x, desc.size.y, desc.size.z));
+    // 转换时在 int64_t 上移位, 移位量不小于 64 位宽时为未定义行为
+    if (desc.normalization.type == raw_normalization::mode::shift && (desc.normalization.shift < -63 || desc.normalization.shift > 63))
+        return std::unexpected(fmt::format("shift normalization {} is outside [-63, 63]", desc.normalization.shift));
+
+    size_t count = static_cast<size_t>(desc.size.x) * desc.size.y * desc.size.z;
+    size_t payload_bytes = count * raw_voxel_type_size(desc.type);
+    if (desc.header_offset + payload_bytes > bytes.size())
+        return std::unexpected(fmt::format("raw data has {} bytes, volume needs {}", bytes.size(), desc.header_offset + payload_bytes));
+    auto payload = bytes.subspan(desc.header_offset, payload_bytes);
+
+    voxel<T> vox = make_voxel<T>(desc.size);
+    std::expected<void, std::string> ret;
+    switch (desc.type)
+    {
+        case raw_voxel_type::u8: ret = raw_ingest_detail::convert<uint8_t>(payload, desc, vox); break;
+        case raw_voxel_type::i8: ret = raw_ingest_detail::convert<int8_t>(payload, desc, vox); break;
+        case raw_voxel_type::u16: ret = raw_ingest_detail::convert<uint16_t>(payload, desc, vox); break;
+        case raw_voxel_type::i16: ret = raw_ingest_detail::convert<int16_t>(payload, desc, vox); break;
+        case raw_voxel_type::u32: ret = raw_ingest_detail::convert<uint32_t>(payload, desc, vox); break;
+        case raw_voxel_type::i32: ret = raw_ingest_detail::convert<int32_t>(payload, desc, vox); break;
+        case raw_voxel_type::f32: ret = raw_ingest_detail::convert<float>(payload, desc, vox); break;
+        case raw_voxel_type::f64: ret = raw_ingest_detail::convert<double>(payload, desc, vox); break;
+    }
+    if (not ret.has_value())
+        return std::unexpected(ret.error());
+    return vox;
+}
+
+// 通过内存映射读取文件, 不产生中间缓冲区
+template <typename T> static inline std::expected<voxel<T>, std::string> ingest_raw_volume(const std::filesystem::path& file, const raw_volume_descriptor& desc)
+{
+    auto mapped_ret = mapped_file::open(file, access_hint::sequential);
+    if (not mapped_ret.has_value())
+        return std::unexpected(mapped_ret.error());
+    auto vox_ret = ingest_raw_volume<T>(mapped_ret.value()->bytes(), desc);
+    if (not vox_ret.has_value())
+        return std::unexpected(fmt::format("{}: {}", file, vox_ret.error()));
+    return vox_ret;
+}
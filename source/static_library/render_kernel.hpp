@@ -0,0 +1,137 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include "interface/volume_view.hpp"
+
+// CPU 渲染内核的编译期组合: 体素类型 x 插值方式 x 合成方式 x 空域跳跃 x 内存布局
+// 体素类型和布局由 volume_view<const T, Layout> 决定, 插值, 合成和是否跳过空宏单元通过 make_dispatch_table 展开成函数指针表
+// 每帧按运行时选项查表一次, 内层循环中只有编译期确定的代码
+
+enum class sample_filter
+{
+    nearest,
+    trilinear,
+};
+inline constexpr size_t sample_filter_count = 2;
+
+enum class composite_mode
+{
+    mean,  // 与片段着色器一致的滑动平均
+    mip,   // 最大值
+    drr,   // 沿光线积分 sum(alpha * step)
+    alpha, // 由前向后的不透明度合成, 累积不透明度接近 1 时提前结束
+};
+inline constexpr size_t composite_mode_count = 4;
+inline constexpr size_t skip_mode_count = 2; // 0: 逐点步进, 1: 跳过空宏单元
+
+namespace render_kernel
+{
+    template <sample_filter F> struct sampler;
+
+    // tex 为 [0, 1] 纹理坐标, 与 OpenGL 最近邻采样相同
+    template <> struct sampler<sample_filter::nearest>
+    {
+        template <typename T, typename Layout> static float sample(const volume_view<const T, Layout>& vol, glm::vec3 tex)
+        {
+            glm::ivec3 v = glm::clamp(glm::ivec3(tex * glm::vec3(vol.size)), glm::ivec3(0), vol.size - 1);
+            return static_cast<float>(vol(v.x, v.y, v.z));
+        }
+    };
+
+    // 与 OpenGL GL_LINEAR + CLAMP_TO_EDGE 相同, 体素中心位于 (i + 0.5) / size
+    template <> struct sampler<sample_filter::trilinear>
+    {
+        template <typename T, typename Layout> static float sample(const volume_view<const T, Layout>& vol, glm::vec3 tex)
+        {
+            glm::vec3 p = glm::clamp(tex * glm::vec3(vol.size) - 0.5f, glm::vec3(0.0f), glm::vec3(vol.size - 1));
+            glm::ivec3 p0 = glm::ivec3(p);
+            glm::ivec3 p1 = glm::min(p0 + 1, vol.size - 1);
+            glm::vec3 f = p - glm::vec3(p0);
+            auto at = [&](int x, int y, int z) { return static_cast<float>(vol(x, y, z)); };
+            float c00 = at(p0.x, p0.y, p0.z) + (at(p1.x, p0.y, p0.z) - at(p0.x, p0.y, p0.z)) * f.x;
+            float c10 = at(p0.x, p1.y, p0.z) + (at(p1.x, p1.y, p0.z) - at(p0.x, p1.y, p0.z)) * f.x;
+            float c01 = at(p0.x, p0.y, p1.z) + (at(p1.x, p0.y, p1.z) - at(p0.x, p0.y, p1.z)) * f.x;
+            float c11 = at(p0.x, p1.y, p1.z) + (at(p1.x, p1.y, p1.z) - at(p0.x, p1.y, p1.z)) * f.x;
+            float c0 = c00 + (c10 - c00) * f.y;
+            float c1 = c01 + (c11 - c01) * f.y;
+            return c0 + (c1 - c0) * f.z;
+        }
+    };
+
+    // 合成器保存单条光线的状态, add 的 hit 为 0 / 1 (低于阈值的采样点为 0), 用选择代替分支
+    // add 返回 false 表示光线可以提前结束
+    template <composite_mode C> struct compositor;
+
+    template <> struct compositor<composite_mode::mean>
+    {
+        float value = 0.0f;
+        int count = 0;
+        bool add(float alpha, int hit, float)
+        {
+            count += hit;
+            value += hit ? (alpha - value) / static_cast<float>(count) : 0.0f;
+            return true;
+        }
+        float result() const { return value; }
+    };
+    template <> struct compositor<composite_mode::mip>
+    {
+        float value = 0.0f;
+        bool add(float alpha, int hit, float)
+        {
+            value = std::max(value, hit ? alpha : 0.0f);
+            return true;
+        }
+        float result() const { return value; }
+    };
+    template <> struct compositor<composite_mode::drr>
+    {
+        float value = 0.0f;
+        bool add(float alpha, int hit, float step)
+        {
+            value += hit ? alpha * step : 0.0f;
+            return true;
+        }
+        float result() const { return value; }
+    };
+    template <> struct compositor<composite_mode::alpha>
+    {
+        float color = 0.0f;
+        float opacity = 0.0f;
+        bool add(float alpha, int hit, float)
+        {
+            float weight = hit ? (1.0f - opacity) * std::min(alpha, 1.0f) : 0.0f;
+            color += weight * alpha;
+            opacity += weight;
+            return opacity < 0.99f;
+        }
+        float result() const { return color; }
+    };
+
+    template <typename Kernels, size_t F, size_t C> constexpr void fill_dispatch_cell(auto& table)
+    {
+        table[F][C][0] = &Kernels::template run<static_cast<sample_filter>(F), static_cast<composite_mode>(C), false>;
+        table[F][C][1] = &Kernels::template run<static_cast<sample_filter>(F), static_cast<composite_mode>(C), true>;
+    }
+    template <typename Kernels, size_t F, size_t... C> constexpr void fill_dispatch_row(auto& table, std::index_sequence<C...>)
+    {
+        (fill_dispatch_cell<Kernels, F, C>(table), ...);
+    }
+    template <typename Fn, typename Kernels, size_t... F> constexpr auto make_dispatch_table(std::index_sequence<F...>)
+    {
+        std::array<std::array<std::array<Fn, skip_mode_count>, composite_mode_count>, sample_filter_count> table{};
+        (fill_dispatch_row<Kernels, F>(table, std::make_index_sequence<composite_mode_count>{}), ...);
+        return table;
+    }
+} // namespace render_kernel
+
+// 为 Kernels::run<filter, composite, skip> 的所有组合生成函数指针表, table[filter][composite][skip]
+template <typename Fn, typename Kernels> constexpr auto make_dispatch_table()
+{
+    return render_kernel::make_dispatch_table<Fn, Kernels>(std::make_index_sequence<sample_filter_count>{});
+}
@@ -0,0 +1,322 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <expected>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <fmt/format.h>
+
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+struct sparse_octree_node
+{
+    uint32_t child_mask = 0;  // 低 8 位: 子节点 (x + 2y + 4z) 是否存在
+    uint32_t first_child = 0; // 存在的子节点连续存放; 倒数第二层指向 leaves, 其余指向 nodes
+};
+
+// 稀疏八叉树: 叶子为 L*L*L 的砖块, 所有体素都低于阈值的砖块不存储, 查询时返回 background
+// nodes[0] 为根节点, 覆盖 [0, L << depth) 的立方体, 节点按层序排列
+// 子节点 i 的位置为 first_child + popcount(child_mask & ((1 << i) - 1)), 与 GPU 端的遍历方式一致
+template <typename T, int L = 8> struct sparse_octree
+{
+    static_assert(L > 0 && (L & (L - 1)) == 0, "leaf size must be a power of two");
+    static constexpr int leaf_size = L;
+    static constexpr int leaf_shift = std::countr_zero(static_cast<unsigned>(L));
+    static constexpr size_t leaf_volume = static_cast<size_t>(L) * L * L;
+
+    glm::ivec3 size{ 0 };
+    int depth = 0; // 根节点到叶子砖块之间的层数
+    T background{};
+    std::vector<sparse_octree_node> nodes;
+    std::vector<T> leaves; // 每个叶子 leaf_volume 个体素, 砖块内按 z, y, x 排列
+
+    int root_extent() const { return L << depth; }
+    size_t leaf_count() const { return leaves.size() / leaf_volume; }
+    size_t memory_bytes() const { return nodes.size() * sizeof(sparse_octree_node) + leaves.size() * sizeof(T); }
+
+    static int child_slot(const sparse_octree_node& node, int child) { return std::popcount(node.child_mask & ((1u << child) - 1u)); }
+
+    // 查找体素所在的叶子, 不存在时返回 -1
+    int64_t find_leaf(int x, int y, int z) const
+    {
+        if (leaves.empty() || x < 0 || y < 0 || z < 0 || x >= size.x || y >= size.y || z >= size.z)
+            return -1;
+        uint32_t index = 0;
+        for (int level = 0; level < depth; ++level)
+        {
+            const auto& node = nodes[index];
+            int shift = leaf_shift + depth - 1 - level;
+            int child = ((x >> shift) & 1) | (((y >> shift) & 1) << 1) | (((z >> shift) & 1) << 2);
+            if ((node.child_mask & (1u << child)) == 0)
+                return -1;
+            index = node.first_child + child_slot(node, child);
+        }
+        return static_cast<int64_t>(index);
+    }
+
+    T at(int x, int y, int z) const
+    {
+        int64_t leaf = find_leaf(x, y, z);
+        if (leaf < 0)
+            return background;
+        size_t local = (static_cast<size_t>(z & (L - 1)) * L + (y & (L - 1))) * L + (x & (L - 1));
+        return leaves[static_cast<size_t>(leaf) * leaf_volume + local];
+    }
+
+    // 三线性插值, 坐标以体素为单位, 体素中心位于整数坐标, 越界部分按边缘钳制
+    float sample(glm::vec3 p) const
+    {
+        p = glm::clamp(p, glm::vec3(0.0f), glm::vec3(size - 1));
+        glm::ivec3 p0 = glm::ivec3(glm::floor(p));
+        glm::ivec3 p1 = glm::min(p0 + 1, size - 1);
+        glm::vec3 f = p - glm::vec3(p0);
+        auto v = [&](int x, int y, int z) { return static_cast<float>(at(x, y, z)); };
+        float c00 = v(p0.x, p0.y, p0.z) + (v(p1.x, p0.y, p0.z) - v(p0.x, p0.y, p0.z)) * f.x;
+        float c10 = v(p0.x, p1.y, p0.z) + (v(p1.x, p1.y, p0.z) - v(p0.x, p1.y, p0.z)) * f.x;
+        float c01 = v(p0.x, p0.y, p1.z) + (v(p1.x, p0.y, p1.z) - v(p0.x, p0.y, p1.z)) * f.x;
+        float c11 = v(p0.x, p1.y, p1.z) + (v(p1.x, p1.y, p1.z) - v(p0.x, p1.y, p1.z)) * f.x;
+        float c0 = c00 + (c10 - c00) * f.y;
+        float c1 = c01 + (c11 - c01) * f.y;
+        return c0 + (c1 - c0) * f.z;
+    }
+
+    // 由近到远遍历光线经过的叶子, 坐标以体素为单位
+    // func(leaf_index, leaf_origin, t_enter, t_exit) 返回 false 时提前结束, 空的子树整个跳过
+    template <typename Func> void traverse(glm::vec3 origin, glm::vec3 direction, float t_min, float t_max, Func&& func) const
+    {
+        if (leaves.empty())
+            return;
+        glm::vec3 inv_direction;
+        for (int i = 0; i < 3; ++i)
+            inv_direction[i] = 1.0f / (std::abs(direction[i]) < 1e-8f ? (direction[i] < 0.0f ? -1e-8f : 1e-8f) : direction[i]);
+        auto intersect = [&](glm::vec3 lo, glm::vec3 hi, float& t0, float& t1) {
+            glm::vec3 a = (lo - origin) * inv_direction;
+            glm::vec3 b = (hi - origin) * inv_direction;
+            glm::vec3 near = glm::min(a, b), far = glm::max(a, b);
+            t0 = std::max(std::max(near.x, near.y), std::max(near.z, t_min));
+            t1 = std::min(std::min(far.x, far.y), std::min(far.z, t_max));
+            return t0 <= t1;
+        };
+
+        struct item
+        {
+            uint32_t index;
+            int level;
+            glm::ivec3 origin;
+            float t0, t1;
+        };
+        std::vector<item> stack;
+        float t0, t1;
+        glm::vec3 clip_hi = glm::vec3(size);
+        if (not intersect(glm::vec3(0.0f), glm::min(glm::vec3(static_cast<float>(root_extent())), clip_hi), t0, t1))
+            return;
+        stack.push_back({ 0, 0, glm::ivec3(0), t0, t1 });
+        while (not stack.empty())
+        {
+            item current = stack.back();
+            stack.pop_back();
+            if (current.level == depth)
+            {
+                if (not func(static_cast<size_t>(current.index), current.origin, current.t0, current.t1))
+                    return;
+                continue;
+            }
+            const auto& node = nodes[current.index];
+            int child_extent = L << (depth - current.level - 1);
+            std::array<item, 8> children;
+            int count = 0;
+            for (int child = 0; child < 8; ++child)
+            {
+                if ((node.child_mask & (1u << child)) == 0)
+                    continue;
+                glm::ivec3 child_origin = current.origin + glm::ivec3(child & 1, (child >> 1) & 1, (child >> 2) & 1) * child_extent;
+                glm::vec3 hi = glm::min(glm::vec3(child_origin + child_extent), clip_hi);
+                if (intersect(glm::vec3(child_origin), hi, t0, t1))
+                    children[count++] = { node.first_child + static_cast<uint32_t>(child_slot(node, child)), current.level + 1, child_origin, t0, t1 };
+            }
+            // 远的先入栈, 近的先出栈; 最多 8 个, 插入排序即可
+            for (int i = 1; i < count; ++i)
+                for (int j = i; j > 0 && children[j - 1].t0 < children[j].t0; --j)
+                    std::swap(children[j - 1], children[j]);
+            stack.insert(stack.end(), children.begin(), children.begin() + count);
+        }
+    }
+};
+
+namespace sparse_octree_detail
+{
+    constexpr uint32_t magic = 0x4f53564d; // "MVSO"
+    constexpr uint32_t version = 1;
+    constexpr size_t header_words = 16;
+} // namespace sparse_octree_detail
+
+// 构建稀疏八叉树, 砖块内存在 >= threshold 的体素时保留整个砖块 (原值不变)
+template <typename T, int L = 8> static inline sparse_octree<T, L> build_sparse_octree(volume_view<const T> vol, T threshold, T background = T{})
+{
+    using octree = sparse_octree<T, L>;
+    octree tree;
+    tree.size = vol.size;
+    tree.background = background;
+    if (vol.memory.empty())
+        return tree;
+
+    glm::ivec3 grid = (vol.size + glm::ivec3(L - 1)) / L;
+    while ((1 << tree.depth) < std::max(std::max(grid.x, grid.y), grid.z))
+        ++tree.depth;
+
+    // 每层的占用情况, level 为 depth 时对应叶子砖块
+    std::vector<std::vector<uint8_t>> occupied(tree.depth + 1);
+    for (int level = 0; level <= tree.depth; ++level)
+        occupied[level].assign(size_t(1) << (3 * level), 0);
+    auto occupancy_index = [](int level, glm::ivec3 c) { return (static_cast<size_t>(c.z) << (2 * level)) + (static_cast<size_t>(c.y) << level) + static_cast<size_t>(c.x); };
+
+    size_t brick_count = static_cast<size_t>(grid.x) * grid.y * grid.z;
+    parallel_for(0, brick_count, 16, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b)
+        {
+            glm::ivec3 brick = { static_cast<int>(b % grid.x), static_cast<int>(b / grid.x % grid.y), static_cast<int>(b / grid.x / grid.y) };
+            glm::ivec3 lo = brick * L;
+            glm::ivec3 hi = glm::min(lo + L, vol.size);
+            bool any = false;
+            for (int z = lo.z; z < hi.z && not any; ++z)
+                for (int y = lo.y; y < hi.y && not any; ++y)
+                {
+                    const T* row = &vol(0, y, z);
+                    for (int x = lo.x; x < hi.x; ++x)
+                        any |= not(row[x] < threshold);
+                }
+            occupied[tree.depth][occupancy_index(tree.depth, brick)] = any;
+        }
+    });
+    for (int level = tree.depth - 1; level >= 0; --level)
+    {
+        int n = 1 << level;
+        for (int z = 0; z < n; ++z)
+            for (int y = 0; y < n; ++y)
+                for (int x = 0; x < n; ++x)
+                {
+                    uint8_t any = 0;
+                    for (int child = 0; child < 8; ++child)
+                        any |= occupied[level + 1][occupancy_index(level + 1, glm::ivec3(x * 2 + (child & 1), y * 2 + ((child >> 1) & 1), z * 2 + ((child >> 2) & 1)))];
+                    occupied[level][occupancy_index(level, glm::ivec3(x, y, z))] = any;
+                }
+    }
+    if (not occupied[0][0])
+        return tree;
+
+    // 按层序分配节点, 同一节点的子节点连续存放
+    struct pending
+    {
+        uint32_t index;
+        int level;
+        glm::ivec3 coord;
+    };
+    std::vector<glm::ivec3> leaf_bricks;
+    if (tree.depth == 0)
+        leaf_bricks.push_back(glm::ivec3(0));
+    else
+    {
+        tree.nodes.push_back({});
+        std::vector<pending> queue = { { 0, 0, glm::ivec3(0) } };
+        for (size_t head = 0; head < queue.size(); ++head)
+        {
+            pending current = queue[head];
+            bool leaf_children = current.level + 1 == tree.depth;
+            tree.nodes[current.index].first_child = static_cast<uint32_t>(leaf_children ? leaf_bricks.size() : tree.nodes.size());
+            for (int child = 0; child < 8; ++child)
+            {
+                glm::ivec3 c = current.coord * 2 + glm::ivec3(child & 1, (child >> 1) & 1, (child >> 2) & 1);
+                if (not occupied[current.level + 1][occupancy_index(current.level + 1, c)])
+                    continue;
+                tree.nodes[current.index].child_mask |= 1u << child;
+                if (leaf_children)
+                    leaf_bricks.push_back(c);
+                else
+                {
+                    queue.push_back({ static_cast<uint32_t>(tree.nodes.size()), current.level + 1, c });
+                    tree.nodes.push_back({});
+                }
+            }
+        }
+    }
+
+    // 拷贝叶子数据, 砖块超出体数据的部分填 background
+    tree.leaves.resize(leaf_bricks.size() * octree::leaf_volume);
+    parallel_for(0, leaf_bricks.size(), 16, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            T* dst = tree.leaves.data() + i * octree::leaf_volume;
+            glm::ivec3 lo = leaf_bricks[i] * L;
+            glm::ivec3 ext = glm::min(glm::ivec3(L), vol.size - lo);
+            std::fill_n(dst, octree::leaf_volume, background);
+            for (int z = 0; z < ext.z; ++z)
+                for (int y = 0; y < ext.y; ++y)
+                    std::copy_n(&vol(lo.x, lo.y + y, lo.z + z), ext.x, dst + (static_cast<size_t>(z) * L + y) * L);
+        }
+    });
+    return tree;
+}
+
+// 紧凑的 32 位字缓冲区: 16 字头部, 节点 (每个 2 字), 叶子数据 (按 4 字节补齐)
+// 可直接作为 GPU 的 SSBO / 纹理缓冲区上传, 也可由 load_sparse_octree 还原
+template <typename T, int L> static inline std::vector<uint32_t> serialize_sparse_octree(const sparse_octree<T, L>& tree)
+{
+    using namespace sparse_octree_detail;
+    size_t leaf_bytes = tree.leaves.size() * sizeof(T);
+    std::vector<uint32_t> buffer(header_words + tree.nodes.size() * 2 + (leaf_bytes + 3) / 4, 0);
+    buffer[0] = magic;
+    buffer[1] = version;
+    buffer[2] = static_cast<uint32_t>(L);
+    buffer[3] = static_cast<uint32_t>(tree.depth);
+    buffer[4] = static_cast<uint32_t>(tree.size.x);
+    buffer[5] = static_cast<uint32_t>(tree.size.y);
+    buffer[6] = static_cast<uint32_t>(tree.size.z);
+    buffer[7] = static_cast<uint32_t>(sizeof(T));
+    buffer[8] = static_cast<uint32_t>(tree.nodes.size());
+    buffer[9] = static_cast<uint32_t>(tree.leaf_count());
+    std::memcpy(&buffer[10], &tree.background, std::min(sizeof(T), sizeof(uint32_t) * 2));
+    uint32_t* node_words = buffer.data() + header_words;
+    for (size_t i = 0; i < tree.nodes.size(); ++i)
+    {
+        node_words[i * 2] = tree.nodes[i].child_mask;
+        node_words[i * 2 + 1] = tree.nodes[i].first_child;
+    }
+    if (leaf_bytes != 0)
+        std::memcpy(node_words + tree.nodes.size() * 2, tree.leaves.data(), leaf_bytes);
+    return buffer;
+}
+
+template <typename T, int L = 8> static inline std::expected<sparse_octree<T, L>, std::string> load_sparse_octree(std::span<const uint32_t> buffer)
+{
+    using namespace sparse_octree_detail;
+    if (buffer.size() < header_words || buffer[0] != magic)
+        return std::unexpected(std::string("not a sparse octree buffer"));
+    if (buffer[1] != version || buffer[2] != static_cast<uint32_t>(L) || buffer[7] != sizeof(T))
+        return std::unexpected(fmt::format("sparse octree layout mismatch (version {}, leaf size {}, voxel bytes {})", buffer[1], buffer[2], buffer[7]));
+
+    sparse_octree<T, L> tree;
+    tree.depth = static_cast<int>(buffer[3]);
+    tree.size = { static_cast<int>(buffer[4]), static_cast<int>(buffer[5]), static_cast<int>(buffer[6]) };
+    size_t node_count = buffer[8];
+    size_t leaf_values = static_cast<size_t>(buffer[9]) * sparse_octree<T, L>::leaf_volume;
+    size_t leaf_bytes = leaf_values * sizeof(T);
+    if (buffer.size() < header_words + node_count * 2 + (leaf_bytes + 3) / 4)
+        return std::unexpected(std::string("truncated sparse octree buffer"));
+    std::memcpy(&tree.background, &buffer[10], std::min(sizeof(T), sizeof(uint32_t) * 2));
+
+    const uint32_t* node_words = buffer.data() + header_words;
+    tree.nodes.resize(node_count);
+    for (size_t i = 0; i < node_count; ++i)
+        tree.nodes[i] = { node_words[i * 2], node_words[i * 2 + 1] };
+    tree.leaves.resize(leaf_values);
+    if (leaf_bytes != 0)
+        std::memcpy(tree.leaves.data(), node_words + node_count * 2, leaf_bytes);
+    return tree;
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include <glm/glm.hpp>
+
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+#include "volume_statistics.hpp"
+
+namespace summed_volume_table_detail
+{
+    // 8/16 位整数的平方和用 64 位整数: 65535^2 * 2^32 个体素以内不溢出; 更宽的类型平方和改用 double
+    template <typename T> using sum_t = std::conditional_t<std::is_floating_point_v<T>, double, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+    template <typename T> using square_t = std::conditional_t<std::is_integral_v<T> && sizeof(T) <= 2, sum_t<T>, double>;
+
+    // 沿三个轴依次做前缀和, table 的尺寸为 size + 1, 第 0 层 / 行 / 列为 0
+    template <typename A> static inline void integrate(voxel<A>& table)
+    {
+        glm::ivec3 size = table.size;
+        size_t row = static_cast<size_t>(size.x);
+        // x: 每行独立
+        parallel_for(0, static_cast<size_t>(size.y) * size.z, 64, [&](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r)
+            {
+                A* p = &table(0, static_cast<int>(r % size.y), static_cast<int>(r / size.y));
+                for (int x = 1; x < size.x; ++x)
+                    p[x] += p[x - 1];
+            }
+        });
+        // y: 每层独立, 整行相加可向量化
+        parallel_for(0, static_cast<size_t>(size.z), 1, [&](size_t begin, size_t end) {
+            for (size_t z = begin; z < end; ++z)
+                for (int y = 1; y < size.y; ++y)
+                {
+                    A* dst = &table(0, y, static_cast<int>(z));
+                    const A* src = &table(0, y - 1, static_cast<int>(z));
+                    for (size_t x = 0; x < row; ++x)
+                        dst[x] += src[x];
+                }
+        });
+        // z: 每个线程负责若干行, 沿 z 逐层累加
+        parallel_for(0, static_cast<size_t>(size.y), 1, [&](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y)
+                for (int z = 1; z < size.z; ++z)
+                {
+                    A* dst = &table(0, static_cast<int>(y), z);
+                    const A* src = &table(0, static_cast<int>(y), z - 1);
+                    for (size_t x = 0; x < row; ++x)
+                        dst[x] += src[x];
+                }
+        });
+    }
+} // namespace summed_volume_table_detail
+
+// 三维积分体 (summed-volume table), 任意轴对齐区域的和, 均值, 方差都是 O(1) 查询
+// sum(x, y, z) 为 [0, x) * [0, y) * [0, z) 内体素之和, 尺寸比源数据各多 1, 查询时没有边界判断
+// 额外占用 (sizeof(sum_type) + sizeof(square_type)) 字节 / 体素, 需要时才构建
+template <typename T> struct summed_volume_table
+{
+    using sum_type = summed_volume_table_detail::sum_t<T>;
+    using square_type = summed_volume_table_detail::square_t<T>;
+
+    glm::ivec3 size{ 0 }; // 源数据尺寸
+    voxel<sum_type> sum;
+    voxel<square_type> sum_sq;
+
+    sum_type box_sum(volume_roi roi) const { return corner_sum(sum, roi.clamp(size)); }
+    square_type box_sum_sq(volume_roi roi) const { return corner_sum(sum_sq, roi.clamp(size)); }
+    size_t box_count(volume_roi roi) const { return roi.clamp(size).count(); }
+
+    double mean(volume_roi roi) const
+    {
+        roi = roi.clamp(size);
+        size_t n = roi.count();
+        return n == 0 ? 0.0 : static_cast<double>(corner_sum(sum, roi)) / static_cast<double>(n);
+    }
+    // 总体方差
+    double variance(volume_roi roi) const
+    {
+        roi = roi.clamp(size);
+        size_t n = roi.count();
+        if (n == 0)
+            return 0.0;
+        double m = static_cast<double>(corner_sum(sum, roi)) / static_cast<double>(n);
+        return std::max(0.0, static_cast<double>(corner_sum(sum_sq, roi)) / static_cast<double>(n) - m * m);
+    }
+
+private:
+    // 容斥: 8 个角点, 无符号类型的中间结果可能回绕, 但最终结果正确
+    template <typename A> static A corner_sum(const voxel<A>& table, volume_roi roi)
+    {
+        if (roi.empty())
+            return A{};
+        glm::ivec3 a = roi.begin, b = roi.end;
+        return table(b.x, b.y, b.z) - table(a.x, b.y, b.z) - table(b.x, a.y, b.z) - table(b.x, b.y, a.z) + table(a.x, a.y, b.z) + table(a.x, b.y, a.z) + table(b.x, a.y, a.z) -
+               table(a.x, a.y, a.z);
+    }
+};
+
+// 并行构建: 先写入带 0 边界的体素值和平方, 再沿 x, y, z 三个方向各做一次前缀和
+template <typename T> static inline summed_volume_table<T> build_summed_volume_table(volume_view<const T> vol)
+{
+    using table_t = summed_volume_table<T>;
+    using A = typename table_t::sum_type;
+    using S = typename table_t::square_type;
+    table_t table;
+    table.size = vol.size;
+    glm::ivec3 size = vol.size + 1;
+    table.sum = make_voxel<A>(size);
+    table.sum_sq = make_voxel<S>(size);
+
+    parallel_for(0, static_cast<size_t>(size.z), 1, [&](size_t begin, size_t end) {
+        for (size_t zz = begin; zz < end; ++zz)
+        {
+            int z = static_cast<int>(zz);
+            for (int y = 0; y < size.y; ++y)
+            {
+                A* sum = &table.sum(0, y, z);
+                S* sum_sq = &table.sum_sq(0, y, z);
+                if (z == 0 || y == 0)
+                {
+                    std::fill_n(sum, size.x, A{});
+                    std::fill_n(sum_sq, size.x, S{});
+                    continue;
+                }
+                const T* in = &vol(0, y - 1, z - 1);
+                sum[0] = A{};
+                sum_sq[0] = S{};
+                for (int x = 1; x < size.x; ++x)
+                {
+                    sum[x] = static_cast<A>(in[x - 1]);
+                    sum_sq[x] = static_cast<S>(in[x - 1]) * static_cast<S>(in[x - 1]);
+                }
+            }
+        }
+    });
+    summed_volume_table_detail::integrate(table.sum);
+    summed_volume_table_detail::integrate(table.sum_sq);
+    return table;
+}
+template <typename T> static inline summed_volume_table<T> build_summed_volume_table(const voxel<T>& vol)
+{
+    return build_summed_volume_table(as_view(vol));
+}
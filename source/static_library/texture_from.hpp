@@ -5,8 +5,38 @@
 
 #include "interface/pixel.hpp"
 #include "interface/voxel.hpp"
+#include "mip_pyramid.hpp"
 
-template <typename T> GLuint texture_from(const voxel<T>& vol, GLuint existed_tex3d = 0)
+namespace texture_from_detail
+{
+    template <typename T> bool tex_image_3d(GLint level, volume_view<const T> vol)
+    {
+        if constexpr (std::is_same_v<T, uint16_t>)
+            glTexImage3D(GL_TEXTURE_3D, level, GL_R16UI, vol.size.x, vol.size.y, vol.size.z, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, vol.memory.data());
+        else if constexpr (std::is_same_v<T, uint8_t>)
+            glTexImage3D(GL_TEXTURE_3D, level, GL_R8UI, vol.size.x, vol.size.y, vol.size.z, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, vol.memory.data());
+        else if constexpr (std::is_same_v<T, glm::vec<2, uint16_t>>)
+            glTexImage3D(GL_TEXTURE_3D, level, GL_RG16UI, vol.size.x, vol.size.y, vol.size.z, 0, GL_RG_INTEGER, GL_UNSIGNED_SHORT, vol.memory.data());
+        else if constexpr (std::is_same_v<T, glm::vec<2, uint8_t>>)
+            glTexImage3D(GL_TEXTURE_3D, level, GL_RG8UI, vol.size.x, vol.size.y, vol.size.z, 0, GL_RG_INTEGER, GL_UNSIGNED_BYTE, vol.memory.data());
+        else if constexpr (std::is_same_v<T, float>)
+            glTexImage3D(GL_TEXTURE_3D, level, GL_R32F, vol.size.x, vol.size.y, vol.size.z, 0, GL_RED, GL_FLOAT, vol.memory.data());
+        // 有符号归一化格式, 着色器中用 sampler3D 读取到 [-1, 1] 并可线性插值 (例如打包的梯度向量)
+        else if constexpr (std::is_same_v<T, glm::vec<4, int8_t>>)
+            glTexImage3D(GL_TEXTURE_3D, level, GL_RGBA8_SNORM, vol.size.x, vol.size.y, vol.size.z, 0, GL_RGBA, GL_BYTE, vol.memory.data());
+        else
+            return false;
+        return true;
+    }
+
+    // 整数内部格式 (R8UI / R16UI / RG16UI ...) 只能最近邻过滤, 用 GL_LINEAR 会使纹理不完整
+    template <typename T> constexpr GLint filter_of()
+    {
+        return std::is_same_v<T, float> || std::is_same_v<T, glm::vec<4, int8_t>> ? GL_LINEAR : GL_NEAREST;
+    }
+} // namespace texture_from_detail
+
+template <typename T> GLuint texture_from(volume_view<const T> vol, GLuint existed_tex3d = 0)
 {
     GLuint tex3d = existed_tex3d;
     if (tex3d == 0)
@@ -14,23 +44,55 @@ template <typename T> GLuint texture_from(const voxel<T>& vol, GLuint existed_te
 
     glBindTexture(GL_TEXTURE_3D, tex3d);
 
-    if constexpr (std::is_same_v<T, uint16_t>)
-        glTexImage3D(GL_TEXTURE_3D, 0, GL_R16UI, vol.size.x, vol.size.y, vol.size.z, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, vol.memory.data());
-    else if constexpr (std::is_same_v<T, uint8_t>)
-        glTexImage3D(GL_TEXTURE_3D, 0, GL_R8UI, vol.size.x, vol.size.y, vol.size.z, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, vol.memory.data());
-    else
+    if (not texture_from_detail::tex_image_3d(0, vol))
         return code_err("{}: Unsupported voxel data type", __func__), 0;
 
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, texture_from_detail::filter_of<T>());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, texture_from_detail::filter_of<T>());
+
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return tex3d;
+}
+
+template <typename T> GLuint texture_from(const voxel<T>& vol, GLuint existed_tex3d = 0)
+{
+    return texture_from(as_view(vol), existed_tex3d);
+}
+
+// 上传整个金字塔作为 mip 级别, 整数纹理只能使用最近邻过滤, 着色器中用 textureLod / texelFetch 选择级别
+template <typename T> GLuint texture_from(const mip_pyramid<T>& pyramid, GLuint existed_tex3d = 0)
+{
+    GLuint tex3d = existed_tex3d;
+    if (tex3d == 0)
+        glGenTextures(1, &tex3d);
+
+    glBindTexture(GL_TEXTURE_3D, tex3d);
+
+    for (int level = 0; level < pyramid.level_count(); ++level)
+        if (not texture_from_detail::tex_image_3d(level, pyramid.level(level)))
+            return code_err("{}: Unsupported voxel data type", __func__), 0;
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, std::max(0, pyramid.level_count() - 1));
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
     glBindTexture(GL_TEXTURE_3D, 0);
     return tex3d;
 }
 
+// 非 std::layout_right 布局先转回 z, y, x 连续排列再上传
+template <typename T, typename Layout> GLuint texture_from(const voxel<T, Layout>& vol, GLuint existed_tex3d = 0)
+{
+    return texture_from(relayout<std::layout_right>(vol), existed_tex3d);
+}
+
 template <typename T> GLuint texture_from(const pixel<T>& img, GLuint existed_tex2d = 0)
 {
     GLuint tex2d = existed_tex2d;
@@ -50,9 +112,16 @@ template <typename T> GLuint texture_from(const pixel<T>& img, GLuint existed_te
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // 只有 RGBA8 是归一化格式, 整数格式使用最近邻
+    GLint filter = std::is_same_v<T, uint32_t> ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
 
     glBindTexture(GL_TEXTURE_2D, 0);
     return tex2d;
+}
+
+template <typename T, typename Layout> GLuint texture_from(const pixel<T, Layout>& img, GLuint existed_tex2d = 0)
+{
+    return texture_from(relayout<std::layout_right>(img), existed_tex2d);
 }
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "volume_file.hpp"
+
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+
+#include <lz4.h>
+
+namespace
+{
+    constexpr char file_magic[4] = { 'M', 'V', 'R', 'V' };
+    constexpr size_t header_bytes = 64;
+    constexpr size_t index_entry_bytes = 32;
+
+    template <typename V> void put(std::vector<std::byte>& out, V value)
+    {
+        if constexpr (std::is_floating_point_v<V>)
+            return put(out, std::bit_cast<uint64_t>(static_cast<double>(value)));
+        else
+        {
+            if constexpr (std::endian::native == std::endian::big && sizeof(V) > 1)
+                value = std::byteswap(value);
+            auto bytes = std::bit_cast<std::array<std::byte, sizeof(V)>>(value);
+            out.insert(out.end(), bytes.begin(), bytes.end());
+        }
+    }
+    template <typename V> V get(std::span<const std::byte> in, size_t offset)
+    {
+        if constexpr (std::is_floating_point_v<V>)
+            return std::bit_cast<double>(get<uint64_t>(in, offset));
+        else
+        {
+            V value;
+            std::memcpy(&value, in.data() + offset, sizeof(V));
+            if constexpr (std::endian::native == std::endian::big && sizeof(V) > 1)
+                value = std::byteswap(value);
+            return value;
+        }
+    }
+
+    // 按元素宽度做差分 / 前缀和, 使用无符号回绕运算保证可逆
+    template <typename U> void delta_encode(std::byte* data, size_t count)
+    {
+        U prev = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            U v;
+            std::memcpy(&v, data + i * sizeof(U), sizeof(U));
+            U d = static_cast<U>(v - prev);
+            prev = v;
+            std::memcpy(data + i * sizeof(U), &d, sizeof(U));
+        }
+    }
+    template <typename U> void delta_decode(std::byte* data, size_t count)
+    {
+        U prev = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            U d;
+            std::memcpy(&d, data + i * sizeof(U), sizeof(U));
+            prev = static_cast<U>(prev + d);
+            std::memcpy(data + i * sizeof(U), &prev, sizeof(U));
+        }
+    }
+    void delta(std::byte* data, size_t count, size_t element_size, bool encode)
+    {
+        switch (element_size)
+        {
+            case 1: return encode ? delta_encode<uint8_t>(data, count) : delta_decode<uint8_t>(data, count);
+            case 2: return encode ? delta_encode<uint16_t>(data, count) : delta_decode<uint16_t>(data, count);
+            case 4: return encode ? delta_encode<uint32_t>(data, count) : delta_decode<uint32_t>(data, count);
+            case 8: return encode ? delta_encode<uint64_t>(data, count) : delta_decode<uint64_t>(data, count);
+        }
+    }
+
+    // 按字节平面重排: 所有元素的第 0 字节, 然后第 1 字节...
+    void shuffle(const std::byte* src, std::byte* dst, size_t count, size_t element_size)
+    {
+        for (size_t b = 0; b < element_size; ++b)
+            for (size_t i = 0; i < count; ++i)
+                dst[b * count + i] = src[i * element_size + b];
+    }
+    void unshuffle(const std::byte* src, std::byte* dst, size_t count, size_t element_size)
+    {
+        for (size_t b = 0; b < element_size; ++b)
+            for (size_t i = 0; i < count; ++i)
+                dst[i * element_size + b] = src[b * count + i];
+    }
+} // namespace
+
+std::vector<std::byte> volume_file_detail::encode_brick(std::span<const std::byte> raw, size_t element_size, bool integral, volume_codec codec)
+{
+    if (codec != volume_codec::lz4 || raw.empty() || raw.size() > static_cast<size_t>(std::numeric_limits<int>::max()))
+        return {};
+
+    size_t count = raw.size() / element_size;
+    std::vector<std::byte> filtered(raw.begin(), raw.end());
+    if (integral)
+        delta(filtered.data(), count, element_size, true);
+    std::vector<std::byte> shuffled(raw.size());
+    shuffle(filtered.data(), shuffled.data(), count, element_size);
+
+    std::vector<std::byte> compressed(static_cast<size_t>(LZ4_compressBound(static_cast<int>(raw.size()))));
+    int written = LZ4_compress_default(reinterpret_cast<const char*>(shuffled.data()), reinterpret_cast<char*>(compressed.data()), static_cast<int>(shuffled.size()),
+                                       static_cast<int>(compressed.size()));
+    if (written <= 0 || static_cast<size_t>(written) >= raw.size())
+        return {};
+    compressed.resize(static_cast<size_t>(written));
+    return compressed;
+}
+
+bool volume_file_detail::decode_brick(std::span<const std::byte> stored, const volume_file_brick& brick, std::span<std::byte> out, size_t element_size, bool integral)
+{
+    switch (brick.encoding)
+    {
+        case volume_brick_encoding::raw:
+        {
+            if (stored.size() != out.size())
+                return false;
+            std::memcpy(out.data(), stored.data(), out.size());
+            return true;
+        }
+        case volume_brick_encoding::compressed:
+        {
+            thread_local std::vector<std::byte> shuffled;
+            shuffled.resize(out.size());
+            int read = LZ4_decompress_safe(reinterpret_cast<const char*>(stored.data()), reinterpret_cast<char*>(shuffled.data()), static_cast<int>(stored.size()),
+                                           static_cast<int>(shuffled.size()));
+            if (read < 0 || static_cast<size_t>(read) != out.size())
+                return false;
+            size_t count = out.size() / element_size;
+            unshuffle(shuffled.data(), out.data(), count, element_size);
+            if (integral)
+                delta(out.data(), count, element_size, false);
+            return true;
+        }
+        case volume_brick_encoding::constant: return false; // 由调用方按类型填充
+    }
+    return false;
+}
+
+std::expected<void, std::string> volume_file_detail::write_file(const std::filesystem::path& file, const volume_file_header& header, std::span<const volume_file_brick> bricks,
+                                                                std::span<const std::vector<std::byte>> payloads)
+{
+    std::vector<std::byte> head;
+    head.reserve(header_bytes + bricks.size() * index_entry_bytes);
+    for (char c : file_magic)
+        head.push_back(static_cast<std::byte>(c));
+    put(head, header.version);
+    put(head, static_cast<uint32_t>(header.type));
+    put(head, static_cast<uint32_t>(header.codec));
+    put(head, static_cast<int32_t>(header.size.x));
+    put(head, static_cast<int32_t>(header.size.y));
+    put(head, static_cast<int32_t>(header.size.z));
+    put(head, static_cast<int32_t>(header.brick_size));
+    put(head, header.value_min);
+    put(head, header.value_max);
+    put(head, static_cast<uint64_t>(bricks.size()));
+    put(head, static_cast<uint64_t>(header_bytes));
+
+    uint64_t offset = header_bytes + bricks.size() * index_entry_bytes;
+    for (size_t i = 0; i < bricks.size(); ++i)
+    {
+        bool has_payload = bricks[i].encoding != volume_brick_encoding::constant;
+        put(head, has_payload ? offset : uint64_t(0));
+        put(head, has_payload ? static_cast<uint32_t>(payloads[i].size()) : uint32_t(0));
+        put(head, static_cast<uint32_t>(bricks[i].encoding));
+        put(head, bricks[i].value_min);
+        put(head, bricks[i].value_max);
+        if (has_payload)
+            offset += payloads[i].size();
+    }
+
+    std::ofstream f(file, std::ios::binary | std::ios::trunc);
+    if (not f.is_open())
+        return std::unexpected(fmt::format("{}: open for writing failed", file));
+    f.write(reinterpret_cast<const char*>(head.data()), static_cast<std::streamsize>(head.size()));
+    for (size_t i = 0; i < bricks.size(); ++i)
+        if (bricks[i].encoding != volume_brick_encoding::constant)
+            f.write(reinterpret_cast<const char*>(payloads[i].data()), static_cast<std::streamsize>(payloads[i].size()));
+    if (not f.good())
+        return std::unexpected(fmt::format("{}: write failed", file));
+    return {};
+}
+
+std::expected<std::shared_ptr<volume_file_reader>, std::string> volume_file_reader::open(const std::filesystem::path& file)
+{
+    auto mapped_ret = mapped_file::open(file, access_hint::random);
+    if (not mapped_ret.has_value())
+        return std::unexpected(mapped_ret.error());
+
+    std::shared_ptr<volume_file_reader> reader(new volume_file_reader());
+    reader->file_path = file;
+    reader->mapped = mapped_ret.value();
+    auto bytes = reader->mapped->bytes();
+
+    if (bytes.size() < header_bytes || std::memcmp(bytes.data(), file_magic, sizeof(file_magic)) != 0)
+        return std::unexpected(fmt::format("{}: not a volume file", file));
+
+    auto& header = reader->file_header;
+    header.version = get<uint32_t>(bytes, 4);
+    if (header.version != volume_file_header::current_version)
+        return std::unexpected(fmt::format("{}: unsupported version {}", file, header.version));
+    header.type = static_cast<raw_voxel_type>(get<uint32_t>(bytes, 8));
+    header.codec = static_cast<volume_codec>(get<uint32_t>(bytes, 12));
+    header.size = { get<int32_t>(bytes, 16), get<int32_t>(bytes, 20), get<int32_t>(bytes, 24) };
+    header.brick_size = get<int32_t>(bytes, 28);
+    header.value_min = get<double>(bytes, 32);
+    header.value_max = get<double>(bytes, 40);
+    uint64_t brick_count = get<uint64_t>(bytes, 48);
+    uint64_t index_offset = get<uint64_t>(bytes, 56);
+
+    if (raw_voxel_type_size(header.type) == 0 || header.brick_size <= 0 || glm::any(glm::lessThan(header.size, glm::ivec3(0))))
+        return std::unexpected(fmt::format("{}: invalid header", file));
+    if (brick_count != header.brick_count() || index_offset + brick_count * index_entry_bytes > bytes.size())
+        return std::unexpected(fmt::format("{}: truncated brick index", file));
+
+    size_t element_size = raw_voxel_type_size(header.type);
+    reader->brick_index.resize(brick_count);
+    for (size_t i = 0; i < brick_count; ++i)
+    {
+        size_t entry = index_offset + i * index_entry_bytes;
+        auto& brick = reader->brick_index[i];
+        brick.offset = get<uint64_t>(bytes, entry);
+        brick.stored_bytes = get<uint32_t>(bytes, entry + 8);
+        brick.encoding = static_cast<volume_brick_encoding>(get<uint32_t>(bytes, entry + 12));
+        brick.value_min = get<double>(bytes, entry + 16);
+        brick.value_max = get<double>(bytes, entry + 24);
+
+        glm::ivec3 ext = header.brick_extent(i);
+        size_t raw_bytes = static_cast<size_t>(ext.x) * ext.y * ext.z * element_size;
+        bool valid = brick.offset + brick.stored_bytes <= bytes.size();
+        if (brick.encoding == volume_brick_encoding::raw)
+            valid = valid && brick.stored_bytes == raw_bytes;
+        else if (brick.encoding != volume_brick_encoding::compressed && brick.encoding != volume_brick_encoding::constant)
+            valid = false;
+        if (not valid)
+            return std::unexpected(fmt::format("{}: invalid index entry for brick {}", file, i));
+    }
+    return reader;
+}
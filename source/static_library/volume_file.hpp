@@ -0,0 +1,323 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/bricked_voxel.hpp"
+#include "interface/voxel.hpp"
+#include "mapped_file.hpp"
+#include "parallel_for.hpp"
+#include "raw_volume_ingest.hpp"
+
+// 原生体数据格式 (.mvv), 所有字段小端序:
+//   header (64 字节): magic "MVRV", version, 体素类型, 压缩方式, 尺寸, 砖块边长, 值域, 砖块数量, 索引偏移
+//   index: 每个砖块 32 字节 (数据偏移, 存储字节数, 编码方式, 值域), 砖块按 z, y, x 排列
+//   payload: 各砖块的数据, 砖块内按 z, y, x 排列, 边缘砖块只存有效部分
+// 每个砖块独立压缩, 可以并行解压, 也可以只读取需要的砖块
+
+enum class volume_codec : uint32_t
+{
+    none = 0,
+    lz4 = 1, // 整数类型先按内存顺序做差分, 再按字节平面重排, 最后 LZ4
+};
+
+enum class volume_brick_encoding : uint32_t
+{
+    raw = 0,
+    compressed = 1,
+    constant = 2, // 整个砖块为同一个值 (value_min), 不占用 payload
+};
+
+struct volume_file_header
+{
+    static constexpr uint32_t current_version = 1;
+
+    uint32_t version = current_version;
+    raw_voxel_type type = raw_voxel_type::u16;
+    volume_codec codec = volume_codec::lz4;
+    glm::ivec3 size{ 0 };
+    int brick_size = 32;
+    double value_min = 0.0;
+    double value_max = 0.0;
+
+    glm::ivec3 brick_grid() const { return (size + glm::ivec3(brick_size - 1)) / brick_size; }
+    size_t brick_count() const
+    {
+        glm::ivec3 grid = brick_grid();
+        return static_cast<size_t>(grid.x) * grid.y * grid.z;
+    }
+    size_t brick_index(glm::ivec3 brick) const
+    {
+        glm::ivec3 grid = brick_grid();
+        return (static_cast<size_t>(brick.z) * grid.y + brick.y) * grid.x + brick.x;
+    }
+    glm::ivec3 brick_coord(size_t index) const
+    {
+        glm::ivec3 grid = brick_grid();
+        return { static_cast<int>(index % grid.x), static_cast<int>(index / grid.x % grid.y), static_cast<int>(index / grid.x / grid.y) };
+    }
+    glm::ivec3 brick_origin(size_t index) const { return brick_coord(index) * brick_size; }
+    glm::ivec3 brick_extent(size_t index) const { return glm::min(glm::ivec3(brick_size), size - brick_origin(index)); }
+};
+
+struct volume_file_brick
+{
+    uint64_t offset = 0;
+    uint32_t stored_bytes = 0;
+    volume_brick_encoding encoding = volume_brick_encoding::raw;
+    double value_min = 0.0;
+    double value_max = 0.0;
+};
+
+namespace volume_file_detail
+{
+    // 压缩一个砖块的原始字节, 失败或压缩无收益时返回空
+    std::vector<std::byte> encode_brick(std::span<const std::byte> raw, size_t element_size, bool integral, volume_codec codec);
+    // 按索引项解码到 out, out 的大小必须等于砖块原始字节数
+    bool decode_brick(std::span<const std::byte> stored, const volume_file_brick& brick, std::span<std::byte> out, size_t element_size, bool integral);
+    std::expected<void, std::string> write_file(const std::filesystem::path& file, const volume_file_header& header, std::span<const volume_file_brick> bricks,
+                                                std::span<const std::vector<std::byte>> payloads);
+
+    template <typename T> static inline void fill_constant(std::span<std::byte> out, double value)
+    {
+        T v = static_cast<T>(value);
+        for (size_t i = 0; i + sizeof(T) <= out.size(); i += sizeof(T))
+            std::memcpy(out.data() + i, &v, sizeof(T));
+    }
+} // namespace volume_file_detail
+
+// 按砖块压缩写出体数据, 砖块并行压缩
+template <typename T>
+static inline std::expected<void, std::string> write_volume_file(const std::filesystem::path& file, volume_view<const T> vol, int brick_size = 32, volume_codec codec = volume_codec::lz4)
+{
+    if (brick_size <= 0)
+        return std::unexpected(fmt::format("{}: invalid brick size {}", file, brick_size));
+
+    volume_file_header header;
+    header.type = raw_voxel_type_of<T>();
+    header.codec = codec;
+    header.size = vol.size;
+    header.brick_size = brick_size;
+
+    size_t count = header.brick_count();
+    std::vector<volume_file_brick> bricks(count);
+    std::vector<std::vector<std::byte>> payloads(count);
+    parallel_for(0, count, 1, [&](size_t begin, size_t end) {
+        std::vector<T> scratch;
+        for (size_t i = begin; i < end; ++i)
+        {
+            glm::ivec3 origin = header.brick_origin(i);
+            glm::ivec3 ext = header.brick_extent(i);
+            scratch.resize(static_cast<size_t>(ext.x) * ext.y * ext.z);
+
+            T lo = std::numeric_limits<T>::max();
+            T hi = std::numeric_limits<T>::lowest();
+            T* dst = scratch.data();
+            for (int z = 0; z < ext.z; ++z)
+                for (int y = 0; y < ext.y; ++y)
+                {
+                    const T* src = &vol(origin.x, origin.y + y, origin.z + z);
+                    for (int x = 0; x < ext.x; ++x)
+                    {
+                        lo = src[x] < lo ? src[x] : lo;
+                        hi = src[x] > hi ? src[x] : hi;
+                    }
+                    dst = std::copy_n(src, ext.x, dst);
+                }
+
+            auto& brick = bricks[i];
+            brick.value_min = static_cast<double>(lo);
+            brick.value_max = static_cast<double>(hi);
+            bool constant = lo == hi;
+            // -0.0 与 +0.0 比较相等, 浮点数按位比较, 常量砖块还原后才能逐位相同
+            if constexpr (std::is_floating_point_v<T>)
+            {
+                using bits_t = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+                constant = constant && std::all_of(scratch.begin(), scratch.end(), [first = std::bit_cast<bits_t>(scratch.front())](T v) { return std::bit_cast<bits_t>(v) == first; });
+            }
+            if (constant)
+            {
+                brick.encoding = volume_brick_encoding::constant;
+                continue;
+            }
+            auto raw = std::as_bytes(std::span<const T>(scratch));
+            payloads[i] = volume_file_detail::encode_brick(raw, sizeof(T), std::is_integral_v<T>, codec);
+            if (payloads[i].empty())
+            {
+                brick.encoding = volume_brick_encoding::raw;
+                payloads[i].assign(raw.begin(), raw.end());
+            }
+            else
+                brick.encoding = volume_brick_encoding::compressed;
+            brick.stored_bytes = static_cast<uint32_t>(payloads[i].size());
+        }
+    });
+
+    header.value_min = std::numeric_limits<double>::max();
+    header.value_max = std::numeric_limits<double>::lowest();
+    for (auto& brick : bricks)
+    {
+        header.value_min = std::min(header.value_min, brick.value_min);
+        header.value_max = std::max(header.value_max, brick.value_max);
+    }
+    if (count == 0)
+        header.value_min = header.value_max = 0.0;
+
+    return volume_file_detail::write_file(file, header, bricks, payloads);
+}
+
+// 通过内存映射读取原生体数据格式, 读取操作线程安全
+class volume_file_reader
+{
+public:
+    static std::expected<std::shared_ptr<volume_file_reader>, std::string> open(const std::filesystem::path& file);
+
+    const volume_file_header& header() const { return file_header; }
+    std::span<const volume_file_brick> bricks() const { return brick_index; }
+    const std::filesystem::path& path() const { return file_path; }
+
+    // 解码单个砖块, out 的长度必须等于该砖块的有效体素数 (brick_extent 的乘积)
+    template <typename T> bool read_brick(size_t index, std::span<T> out) const
+    {
+        if (raw_voxel_type_of<T>() != file_header.type || index >= brick_index.size())
+            return false;
+        glm::ivec3 ext = file_header.brick_extent(index);
+        if (out.size() != static_cast<size_t>(ext.x) * ext.y * ext.z)
+            return false;
+        const auto& brick = brick_index[index];
+        auto bytes = std::as_writable_bytes(out);
+        if (brick.encoding == volume_brick_encoding::constant)
+        {
+            volume_file_detail::fill_constant<T>(bytes, brick.value_min);
+            return true;
+        }
+        return volume_file_detail::decode_brick(mapped->bytes().subspan(brick.offset, brick.stored_bytes), brick, bytes, sizeof(T), std::is_integral_v<T>);
+    }
+
+    // 读取整个体数据, 砖块并行解压
+    template <typename T> std::expected<voxel<T>, std::string> read_all() const { return read_region<T>(glm::ivec3(0), file_header.size); }
+
+    // 读取 [origin, origin + size) 区域, 只解压与区域相交的砖块
+    template <typename T> std::expected<voxel<T>, std::string> read_region(glm::ivec3 origin, glm::ivec3 size) const
+    {
+        if (raw_voxel_type_of<T>() != file_header.type)
+            return std::unexpected(fmt::format("{}: voxel type mismatch", file_path));
+        glm::ivec3 end = origin + size;
+        if (glm::any(glm::lessThan(origin, glm::ivec3(0))) || glm::any(glm::greaterThan(end, file_header.size)) || glm::any(glm::lessThanEqual(size, glm::ivec3(0))))
+            return std::unexpected(fmt::format("{}: region out of range", file_path));
+
+        glm::ivec3 first = origin / file_header.brick_size;
+        glm::ivec3 last = (end - 1) / file_header.brick_size;
+        glm::ivec3 span = last - first + 1;
+        size_t count = static_cast<size_t>(span.x) * span.y * span.z;
+
+        voxel<T> vox = make_voxel<T>(size);
+        std::atomic<bool> failed = false;
+        parallel_for(0, count, 1, [&](size_t begin, size_t stop) {
+            std::vector<T> scratch;
+            for (size_t i = begin; i < stop && not failed; ++i)
+            {
+                glm::ivec3 brick = first + glm::ivec3(static_cast<int>(i % span.x), static_cast<int>(i / span.x % span.y), static_cast<int>(i / span.x / span.y));
+                size_t index = file_header.brick_index(brick);
+                glm::ivec3 ext = file_header.brick_extent(index);
+                scratch.resize(static_cast<size_t>(ext.x) * ext.y * ext.z);
+                if (not read_brick<T>(index, scratch))
+                {
+                    failed = true;
+                    return;
+                }
+
+                // 砖块与区域的交集, 逐行拷贝
+                glm::ivec3 brick_origin = file_header.brick_origin(index);
+                glm::ivec3 lo = glm::max(brick_origin, origin);
+                glm::ivec3 hi = glm::min(brick_origin + ext, end);
+                for (int z = lo.z; z < hi.z; ++z)
+                    for (int y = lo.y; y < hi.y; ++y)
+                    {
+                        const T* src = scratch.data() + (static_cast<size_t>(z - brick_origin.z) * ext.y + (y - brick_origin.y)) * ext.x + (lo.x - brick_origin.x);
+                        std::copy_n(src, hi.x - lo.x, &vox(lo.x - origin.x, y - origin.y, z - origin.z));
+                    }
+            }
+        });
+        if (failed)
+            return std::unexpected(fmt::format("{}: corrupted brick data", file_path));
+        return vox;
+    }
+
+    // 读取为分块体数据; 文件砖块边长等于 N 时完整砖块直接解压到目标砖块的内存, 不经过中间缓冲和重排
+    template <typename T, int N> std::expected<bricked_voxel<T, N>, std::string> read_bricked() const
+    {
+        if (file_header.brick_size != N)
+        {
+            auto vox_ret = read_all<T>();
+            if (not vox_ret.has_value())
+                return std::unexpected(vox_ret.error());
+            return make_bricked_voxel<T, N>(vox_ret.value());
+        }
+        if (raw_voxel_type_of<T>() != file_header.type)
+            return std::unexpected(fmt::format("{}: voxel type mismatch", file_path));
+
+        auto vox = make_bricked_voxel<T, N>(file_header.size);
+        std::atomic<bool> failed = false;
+        parallel_for(0, vox.brick_count(), 1, [&](size_t begin, size_t stop) {
+            std::vector<T> scratch;
+            for (size_t i = begin; i < stop && not failed; ++i)
+            {
+                auto brick = vox.brick_at(i);
+                glm::ivec3 ext = file_header.brick_extent(i);
+                if (ext == glm::ivec3(N))
+                {
+                    failed = failed || not read_brick<T>(i, std::span<T>(brick.memory));
+                    continue;
+                }
+                // 边缘砖块在文件中只存有效部分, 逐行放入补齐的砖块
+                scratch.resize(static_cast<size_t>(ext.x) * ext.y * ext.z);
+                if (not read_brick<T>(i, scratch))
+                {
+                    failed = true;
+                    return;
+                }
+                for (int z = 0; z < ext.z; ++z)
+                    for (int y = 0; y < ext.y; ++y)
+                        std::copy_n(scratch.data() + (static_cast<size_t>(z) * ext.y + y) * ext.x, ext.x, &brick(0, y, z));
+            }
+        });
+        if (failed)
+            return std::unexpected(fmt::format("{}: corrupted brick data", file_path));
+        return vox;
+    }
+
+private:
+    volume_file_reader() = default;
+
+    std::filesystem::path file_path;
+    std::shared_ptr<mapped_file> mapped;
+    volume_file_header file_header;
+    std::vector<volume_file_brick> brick_index;
+};
+
+template <typename T> static inline std::expected<voxel<T>, std::string> load_volume_file(const std::filesystem::path& file)
+{
+    auto reader_ret = volume_file_reader::open(file);
+    if (not reader_ret.has_value())
+        return std::unexpected(reader_ret.error());
+    return reader_ret.value()->read_all<T>();
+}
+template <typename T, int N = 16> static inline std::expected<bricked_voxel<T, N>, std::string> load_bricked_volume_file(const std::filesystem::path& file)
+{
+    auto reader_ret = volume_file_reader::open(file);
+    if (not reader_ret.has_value())
+        return std::unexpected(reader_ret.error());
+    return reader_ret.value()->read_bricked<T, N>();
+}
@@ -0,0 +1,337 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+// CT 去噪滤波, 输入输出都是 voxel<uint16_t>, 边界按钳制到边缘处理
+// 所有滤波的内层循环都沿 x 连续读写, 外层循环遍历邻域偏移, 交给编译器向量化
+
+namespace volume_filter_detail
+{
+    constexpr int tile_width = 512; // y / z 方向按 x 分块, 邻域内的行片段常驻 L1 / L2
+
+    static inline uint16_t store(float value)
+    {
+        return static_cast<uint16_t>(std::clamp(value + 0.5f, 0.0f, 65535.0f));
+    }
+
+    // 归一化的一维高斯核, 半径为 ceil(3 sigma)
+    static inline std::vector<float> gaussian_kernel(float sigma)
+    {
+        if (sigma <= 0.0f)
+            return { 1.0f };
+        int radius = static_cast<int>(std::ceil(3.0f * sigma));
+        std::vector<float> kernel(2 * radius + 1);
+        float sum = 0.0f;
+        for (int i = -radius; i <= radius; ++i)
+            sum += kernel[i + radius] = std::exp(-0.5f * static_cast<float>(i * i) / (sigma * sigma));
+        for (auto& w : kernel)
+            w /= sum;
+        return kernel;
+    }
+
+    // 把第 (y, z) 行复制到左右各扩展 radius 个体素的缓冲区, 扩展部分取边缘值
+    template <typename T> static inline void padded_row(volume_view<const uint16_t> vol, int y, int z, int radius, T* out)
+    {
+        const uint16_t* in = &vol(0, y, z);
+        for (int i = 0; i < radius; ++i)
+        {
+            out[i] = static_cast<T>(in[0]);
+            out[radius + vol.size.x + i] = static_cast<T>(in[vol.size.x - 1]);
+        }
+        for (int x = 0; x < vol.size.x; ++x)
+            out[radius + x] = static_cast<T>(in[x]);
+    }
+
+    // 为每个 (dy, dz) 准备一份扩展行, rows[(dz + r) * (2r + 1) + (dy + r)] 指向行首 (扩展部分之后)
+    template <typename T> struct neighborhood_rows
+    {
+        int radius = 0;
+        int stride = 0;
+        std::vector<T> storage;
+        std::vector<const T*> rows;
+
+        void load(volume_view<const uint16_t> vol, int y, int z, int r)
+        {
+            radius = r;
+            stride = vol.size.x + 2 * r;
+            int side = 2 * r + 1;
+            storage.resize(static_cast<size_t>(side) * side * stride);
+            rows.resize(static_cast<size_t>(side) * side);
+            for (int dz = -r; dz <= r; ++dz)
+                for (int dy = -r; dy <= r; ++dy)
+                {
+                    int index = (dz + r) * side + (dy + r);
+                    T* dst = storage.data() + static_cast<size_t>(index) * stride;
+                    padded_row(vol, std::clamp(y + dy, 0, vol.size.y - 1), std::clamp(z + dz, 0, vol.size.z - 1), r, dst);
+                    rows[index] = dst + r;
+                }
+        }
+        // 偏移 (dx, dy, dz) 处的行, 第 x 个元素即体素 (x + dx, y + dy, z + dz)
+        const T* at(int dx, int dy, int dz) const { return rows[(dz + radius) * (2 * radius + 1) + (dy + radius)] + dx; }
+    };
+} // namespace volume_filter_detail
+
+// 可分离高斯滤波: x 方向输出到 float 中间体, y 方向逐层原地处理, z 方向直接写回 uint16
+// y / z 两趟按 x 分块, 并行单位分别为 (z 层, 分块) 和 (y 行, 分块)
+static inline voxel<uint16_t> gaussian_filter(volume_view<const uint16_t> vol, glm::vec3 sigma)
+{
+    using namespace volume_filter_detail;
+    glm::ivec3 size = vol.size;
+    voxel<uint16_t> result = make_voxel<uint16_t>(size);
+    if (result.memory.empty())
+        return result;
+    auto kx = gaussian_kernel(sigma.x), ky = gaussian_kernel(sigma.y), kz = gaussian_kernel(sigma.z);
+    int rx = static_cast<int>(kx.size() / 2), ry = static_cast<int>(ky.size() / 2), rz = static_cast<int>(kz.size() / 2);
+    voxel<float> temp = make_voxel<float>(size);
+
+    parallel_for(0, static_cast<size_t>(size.y) * size.z, 16, [&](size_t begin, size_t end) {
+        std::vector<float> padded(size.x + 2 * rx);
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = static_cast<int>(row % size.y);
+            int z = static_cast<int>(row / size.y);
+            padded_row(vol, y, z, rx, padded.data());
+            float* out = &temp(0, y, z);
+            std::fill_n(out, size.x, 0.0f);
+            for (int k = 0; k <= 2 * rx; ++k)
+            {
+                const float* in = padded.data() + k;
+                float w = kx[k];
+                for (int x = 0; x < size.x; ++x)
+                    out[x] += w * in[x];
+            }
+        }
+    });
+
+    int tiles = (size.x + tile_width - 1) / tile_width;
+    parallel_for(0, static_cast<size_t>(size.z) * tiles, 1, [&](size_t begin, size_t end) {
+        std::vector<float> slice(static_cast<size_t>(size.y) * tile_width);
+        for (size_t task = begin; task < end; ++task)
+        {
+            int z = static_cast<int>(task / tiles);
+            int x0 = static_cast<int>(task % tiles) * tile_width;
+            int width = std::min(tile_width, size.x - x0);
+            for (int y = 0; y < size.y; ++y)
+            {
+                float* out = slice.data() + static_cast<size_t>(y) * tile_width;
+                std::fill_n(out, width, 0.0f);
+                for (int k = -ry; k <= ry; ++k)
+                {
+                    const float* in = &temp(x0, std::clamp(y + k, 0, size.y - 1), z);
+                    float w = ky[k + ry];
+                    for (int x = 0; x < width; ++x)
+                        out[x] += w * in[x];
+                }
+            }
+            for (int y = 0; y < size.y; ++y)
+                std::copy_n(slice.data() + static_cast<size_t>(y) * tile_width, width, &temp(x0, y, z));
+        }
+    });
+
+    parallel_for(0, static_cast<size_t>(size.y) * tiles, 1, [&](size_t begin, size_t end) {
+        std::vector<float> acc(tile_width);
+        for (size_t task = begin; task < end; ++task)
+        {
+            int y = static_cast<int>(task / tiles);
+            int x0 = static_cast<int>(task % tiles) * tile_width;
+            int width = std::min(tile_width, size.x - x0);
+            for (int z = 0; z < size.z; ++z)
+            {
+                std::fill_n(acc.data(), width, 0.0f);
+                for (int k = -rz; k <= rz; ++k)
+                {
+                    const float* in = &temp(x0, y, std::clamp(z + k, 0, size.z - 1));
+                    float w = kz[k + rz];
+                    for (int x = 0; x < width; ++x)
+                        acc[x] += w * in[x];
+                }
+                uint16_t* out = &result(x0, y, z);
+                for (int x = 0; x < width; ++x)
+                    out[x] = store(acc[x]);
+            }
+        }
+    });
+    return result;
+}
+
+// 3x3x3 中值滤波, 使用遗忘选择 (forgetful selection): 先装入 15 个值, 每次去掉最小和最大值再补入一个
+// 比较交换都是逐元素 min / max, 一次处理一行中 lanes 个体素, 没有数据相关的分支
+static inline voxel<uint16_t> median_filter(volume_view<const uint16_t> vol)
+{
+    using namespace volume_filter_detail;
+    constexpr int lanes = 64;
+    glm::ivec3 size = vol.size;
+    voxel<uint16_t> result = make_voxel<uint16_t>(size);
+    if (result.memory.empty())
+        return result;
+
+    parallel_for(0, static_cast<size_t>(size.y) * size.z, 4, [&](size_t begin, size_t end) {
+        neighborhood_rows<uint16_t> rows;
+        std::array<const uint16_t*, 27> source;
+        alignas(64) uint16_t buffer[15][lanes];
+        auto cswap = [](uint16_t* a, uint16_t* b, int n) {
+            for (int l = 0; l < n; ++l)
+            {
+                uint16_t lo = std::min(a[l], b[l]);
+                uint16_t hi = std::max(a[l], b[l]);
+                a[l] = lo;
+                b[l] = hi;
+            }
+        };
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = static_cast<int>(row % size.y);
+            int z = static_cast<int>(row / size.y);
+            rows.load(vol, y, z, 1);
+            int count = 0;
+            for (int dz = -1; dz <= 1; ++dz)
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx)
+                        source[count++] = rows.at(dx, dy, dz);
+            uint16_t* out = &result(0, y, z);
+            for (int x0 = 0; x0 < size.x; x0 += lanes)
+            {
+                int n = std::min(lanes, size.x - x0);
+                for (int i = 0; i < 15; ++i)
+                    std::copy_n(source[i] + x0, n, buffer[i]);
+                int m = 15;
+                for (int next = 15; next < 27; ++next)
+                {
+                    // 最小值移到 buffer[0], 最大值移到 buffer[m - 1], 两者都不可能是中值
+                    for (int i = 1; i < m; ++i)
+                        cswap(buffer[0], buffer[i], n);
+                    for (int i = 1; i < m - 1; ++i)
+                        cswap(buffer[i], buffer[m - 1], n);
+                    std::copy_n(source[next] + x0, n, buffer[0]);
+                    --m;
+                }
+                // 剩余 3 个值的中值
+                for (int l = 0; l < n; ++l)
+                {
+                    uint16_t a = buffer[0][l], b = buffer[1][l], c = buffer[2][l];
+                    out[x0 + l] = std::max(std::min(a, b), std::min(std::max(a, b), c));
+                }
+            }
+        }
+    });
+    return result;
+}
+
+// 双边滤波, 邻域为 (2 * radius + 1)^3, 权重 = 空间高斯 * 值域高斯
+// 值域权重查表: |差值| 在 [0, 4 range_sigma) 内分 1024 级, 超出部分权重为 0
+static inline voxel<uint16_t> bilateral_filter(volume_view<const uint16_t> vol, float spatial_sigma, float range_sigma, int radius = 1)
+{
+    using namespace volume_filter_detail;
+    constexpr int range_bins = 1024;
+    glm::ivec3 size = vol.size;
+    voxel<uint16_t> result = make_voxel<uint16_t>(size);
+    if (result.memory.empty())
+        return result;
+    radius = std::max(radius, 0);
+    spatial_sigma = std::max(spatial_sigma, 1e-3f);
+    range_sigma = std::max(range_sigma, 1e-3f);
+
+    std::array<float, range_bins + 1> range_weight;
+    float range_scale = static_cast<float>(range_bins) / (4.0f * range_sigma);
+    for (int i = 0; i < range_bins; ++i)
+    {
+        float d = static_cast<float>(i) / range_scale;
+        range_weight[i] = std::exp(-0.5f * d * d / (range_sigma * range_sigma));
+    }
+    range_weight[range_bins] = 0.0f;
+
+    parallel_for(0, static_cast<size_t>(size.y) * size.z, 4, [&](size_t begin, size_t end) {
+        neighborhood_rows<float> rows;
+        std::vector<float> sum(size.x), weight(size.x);
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = static_cast<int>(row % size.y);
+            int z = static_cast<int>(row / size.y);
+            rows.load(vol, y, z, radius);
+            const float* center = rows.at(0, 0, 0);
+            std::fill(sum.begin(), sum.end(), 0.0f);
+            std::fill(weight.begin(), weight.end(), 0.0f);
+            for (int dz = -radius; dz <= radius; ++dz)
+                for (int dy = -radius; dy <= radius; ++dy)
+                    for (int dx = -radius; dx <= radius; ++dx)
+                    {
+                        float spatial = std::exp(-0.5f * static_cast<float>(dx * dx + dy * dy + dz * dz) / (spatial_sigma * spatial_sigma));
+                        const float* in = rows.at(dx, dy, dz);
+                        for (int x = 0; x < size.x; ++x)
+                        {
+                            auto bin = static_cast<int>(std::min(std::abs(in[x] - center[x]) * range_scale, static_cast<float>(range_bins)));
+                            float w = spatial * range_weight[bin];
+                            sum[x] += w * in[x];
+                            weight[x] += w;
+                        }
+                    }
+            // 中心体素的权重恒为 1, weight 不会为 0
+            uint16_t* out = &result(0, y, z);
+            for (int x = 0; x < size.x; ++x)
+                out[x] = store(sum[x] / weight[x]);
+        }
+    });
+    return result;
+}
+
+struct filter_timing
+{
+    std::string name;
+    double seconds = 0.0;
+};
+
+// 加载时的预处理链, 按添加顺序执行, 每一级的耗时写入 timings 并输出日志
+struct filter_pipeline
+{
+    using stage = std::function<voxel<uint16_t>(volume_view<const uint16_t>)>;
+
+    std::vector<std::pair<std::string, stage>> stages;
+
+    filter_pipeline& add(std::string name, stage func)
+    {
+        stages.emplace_back(std::move(name), std::move(func));
+        return *this;
+    }
+    filter_pipeline& gaussian(glm::vec3 sigma)
+    {
+        return add("gaussian", [sigma](volume_view<const uint16_t> vol) { return gaussian_filter(vol, sigma); });
+    }
+    filter_pipeline& median()
+    {
+        return add("median", [](volume_view<const uint16_t> vol) { return median_filter(vol); });
+    }
+    filter_pipeline& bilateral(float spatial_sigma, float range_sigma, int radius = 1)
+    {
+        return add("bilateral", [=](volume_view<const uint16_t> vol) { return bilateral_filter(vol, spatial_sigma, range_sigma, radius); });
+    }
+
+    bool empty() const { return stages.empty(); }
+
+    voxel<uint16_t> run(voxel<uint16_t> vol, std::vector<filter_timing>* timings = nullptr) const
+    {
+        for (const auto& [name, func] : stages)
+        {
+            auto start = std::chrono::steady_clock::now();
+            vol = func(as_view(vol));
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            SPDLOG_INFO("filter {}: {:.3f} ms ({}x{}x{})", name, seconds * 1000.0, vol.size.x, vol.size.y, vol.size.z);
+            if (timings)
+                timings->push_back({ name, seconds });
+        }
+        return vol;
+    }
+};
@@ -0,0 +1,280 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "interface/bricked_voxel.hpp"
+#include "interface/voxel.hpp"
+#include "parallel_for.hpp"
+
+// 轴对齐的统计区域 [begin, end), 超出体数据的部分会被裁掉, 默认覆盖整个体
+struct volume_roi
+{
+    glm::ivec3 begin{ 0 };
+    glm::ivec3 end{ std::numeric_limits<int>::max() };
+
+    volume_roi clamp(glm::ivec3 size) const
+    {
+        volume_roi roi;
+        roi.begin = glm::clamp(begin, glm::ivec3(0), size);
+        roi.end = glm::clamp(end, roi.begin, size);
+        return roi;
+    }
+    bool empty() const { return glm::any(glm::lessThanEqual(end, begin)); }
+    size_t count() const { return empty() ? 0 : static_cast<size_t>(end.x - begin.x) * (end.y - begin.y) * (end.z - begin.z); }
+};
+
+// 8/16 位整数的全分辨率直方图, counts[v] 为值 v 的体素数, 百分位数是精确值
+template <typename T> struct volume_histogram
+{
+    static_assert(std::is_integral_v<T> && std::is_unsigned_v<T> && sizeof(T) <= 2, "histogram supports 8/16-bit unsigned voxels");
+    static constexpr size_t bin_count = size_t(1) << (8 * sizeof(T));
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(bin_count, 0);
+    uint64_t total = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = 0;
+    double mean = 0.0;
+    double stddev = 0.0;
+
+    // 至少 p (0 ~ 1) 的体素不大于返回值
+    T percentile(double p) const
+    {
+        if (total == 0)
+            return 0;
+        auto target = static_cast<uint64_t>(std::ceil(std::clamp(p, 0.0, 1.0) * static_cast<double>(total)));
+        target = std::max<uint64_t>(target, 1);
+        uint64_t sum = 0;
+        for (size_t v = min; v <= max; ++v)
+            if ((sum += counts[v]) >= target)
+                return static_cast<T>(v);
+        return max;
+    }
+    // 自动窗宽窗位: 去掉两端各 clip 比例的体素后的取值范围
+    glm::vec<2, T> window(double clip = 0.01) const { return { percentile(clip), percentile(1.0 - clip) }; }
+};
+
+// 低能 (miu) - 高能 (Zeff) 联合直方图, 映射规则与 material_lut 相同: bin = min(v * size / (value_max + 1), size - 1)
+struct joint_histogram
+{
+    glm::ivec2 size{ 256 };
+    glm::uvec2 value_max{ 255 };
+    std::vector<uint64_t> counts; // index: he_bin * size.x + le_bin
+
+    uint64_t operator()(int le_bin, int he_bin) const { return counts[static_cast<size_t>(he_bin) * size.x + le_bin]; }
+};
+
+struct dual_energy_statistics
+{
+    volume_histogram<uint16_t> le;
+    volume_histogram<uint16_t> he;
+    joint_histogram joint;
+};
+
+namespace volume_statistics_detail
+{
+    // 每个工作线程私有的 32 位计数, 计满前倒入 64 位累加器, 最后由调用方合并
+    struct private_bins
+    {
+        static constexpr uint64_t flush_limit = std::numeric_limits<uint32_t>::max() - (uint64_t(1) << 20);
+
+        std::vector<uint32_t> counts;
+        std::vector<uint64_t> spilled;
+        uint64_t pending = 0;
+
+        void prepare(size_t bins)
+        {
+            if (counts.empty())
+                counts.assign(bins, 0);
+        }
+        // 即将写入 n 个样本, 必要时先倒空 32 位计数
+        void reserve(size_t n)
+        {
+            if (pending + n <= flush_limit)
+            {
+                pending += n;
+                return;
+            }
+            flush();
+            pending = n;
+        }
+        void flush()
+        {
+            if (spilled.empty())
+                spilled.assign(counts.size(), 0);
+            for (size_t i = 0; i < counts.size(); ++i)
+                spilled[i] += std::exchange(counts[i], 0);
+            pending = 0;
+        }
+        void merge_into(std::vector<uint64_t>& target) const
+        {
+            for (size_t i = 0; i < counts.size(); ++i)
+                target[i] += counts[i] + (spilled.empty() ? 0 : spilled[i]);
+        }
+    };
+
+    static inline uint32_t joint_scale(int bins, uint32_t value_max)
+    {
+        return static_cast<uint32_t>(std::min<uint64_t>((static_cast<uint64_t>(bins) << 16) / (static_cast<uint64_t>(value_max) + 1), 65536));
+    }
+
+    // 由计数得出 min, max, 均值和标准差
+    template <typename T> static inline void finish(volume_histogram<T>& hist)
+    {
+        double sum = 0.0, sum_sq = 0.0;
+        for (size_t v = 0; v < hist.counts.size(); ++v)
+        {
+            uint64_t n = hist.counts[v];
+            if (n == 0)
+                continue;
+            hist.min = std::min(hist.min, static_cast<T>(v));
+            hist.max = std::max(hist.max, static_cast<T>(v));
+            hist.total += n;
+            sum += static_cast<double>(n) * static_cast<double>(v);
+            sum_sq += static_cast<double>(n) * static_cast<double>(v) * static_cast<double>(v);
+        }
+        if (hist.total == 0)
+            return;
+        hist.mean = sum / static_cast<double>(hist.total);
+        hist.stddev = std::sqrt(std::max(0.0, sum_sq / static_cast<double>(hist.total) - hist.mean * hist.mean));
+    }
+} // namespace volume_statistics_detail
+
+// 单体直方图, 按 roi 内的行并行, 每个工作线程写私有计数, 结束后合并
+template <typename T> static inline volume_histogram<T> compute_histogram(volume_view<const T> vol, volume_roi roi = {})
+{
+    using namespace volume_statistics_detail;
+    volume_histogram<T> hist;
+    roi = roi.clamp(vol.size);
+    if (roi.empty())
+        return hist;
+
+    glm::ivec3 extent = roi.end - roi.begin;
+    size_t rows = static_cast<size_t>(extent.y) * extent.z;
+    std::vector<private_bins> partial(parallel_worker_count());
+    parallel_for_workers(0, rows, 64, [&](size_t worker, size_t begin, size_t end) {
+        auto& bins = partial[worker];
+        bins.prepare(hist.bin_count);
+        bins.reserve((end - begin) * extent.x);
+        uint32_t* counts = bins.counts.data();
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = roi.begin.y + static_cast<int>(row % extent.y);
+            int z = roi.begin.z + static_cast<int>(row / extent.y);
+            const T* in = &vol(roi.begin.x, y, z);
+            for (int x = 0; x < extent.x; ++x)
+                ++counts[in[x]];
+        }
+    });
+    for (const auto& bins : partial)
+        bins.merge_into(hist.counts);
+    finish(hist);
+    return hist;
+}
+template <typename T> static inline volume_histogram<T> compute_histogram(const voxel<T>& vol, volume_roi roi = {})
+{
+    return compute_histogram(as_view(vol), roi);
+}
+
+// 分块体数据的直方图, 按砖块并行; 完整砖块是一段连续内存, 直接顺序扫描, 边缘砖块跳过补齐的体素
+template <typename T, int N> static inline volume_histogram<T> compute_histogram(const bricked_voxel<T, N>& vol)
+{
+    using namespace volume_statistics_detail;
+    volume_histogram<T> hist;
+    std::vector<private_bins> partial(parallel_worker_count());
+    parallel_for_workers(0, vol.brick_count(), 1, [&](size_t worker, size_t begin, size_t end) {
+        auto& bins = partial[worker];
+        bins.prepare(hist.bin_count);
+        uint32_t* counts = bins.counts.data();
+        for (size_t index = begin; index < end; ++index)
+        {
+            auto brick = vol.brick_at(index);
+            glm::ivec3 ext = brick.extent(vol.size);
+            bins.reserve(static_cast<size_t>(ext.x) * ext.y * ext.z);
+            if (ext == glm::ivec3(N))
+            {
+                for (T v : brick.memory)
+                    ++counts[v];
+                continue;
+            }
+            for (int z = 0; z < ext.z; ++z)
+                for (int y = 0; y < ext.y; ++y)
+                {
+                    const T* in = &brick(0, y, z);
+                    for (int x = 0; x < ext.x; ++x)
+                        ++counts[in[x]];
+                }
+        }
+    });
+    for (const auto& bins : partial)
+        bins.merge_into(hist.counts);
+    finish(hist);
+    return hist;
+}
+
+// 一次遍历同时得到低能, 高能直方图和联合直方图, 两个体只各读一次
+static inline dual_energy_statistics compute_dual_energy_statistics(volume_view<const uint16_t> le, volume_view<const uint16_t> he, volume_roi roi = {},
+                                                                    glm::ivec2 joint_size = glm::ivec2(256), glm::uvec2 joint_value_max = glm::uvec2(255))
+{
+    using namespace volume_statistics_detail;
+    dual_energy_statistics stats;
+    stats.joint.size = glm::max(joint_size, glm::ivec2(1));
+    stats.joint.value_max = joint_value_max;
+    stats.joint.counts.assign(static_cast<size_t>(stats.joint.size.x) * stats.joint.size.y, 0);
+    roi = roi.clamp(glm::min(le.size, he.size));
+    if (roi.empty())
+        return stats;
+
+    constexpr size_t bin_count = volume_histogram<uint16_t>::bin_count;
+    uint32_t scale_x = joint_scale(stats.joint.size.x, joint_value_max.x);
+    uint32_t scale_y = joint_scale(stats.joint.size.y, joint_value_max.y);
+    uint32_t max_x = static_cast<uint32_t>(stats.joint.size.x - 1);
+    uint32_t max_y = static_cast<uint32_t>(stats.joint.size.y - 1);
+    uint32_t stride = static_cast<uint32_t>(stats.joint.size.x);
+
+    glm::ivec3 extent = roi.end - roi.begin;
+    size_t rows = static_cast<size_t>(extent.y) * extent.z;
+    size_t workers = parallel_worker_count();
+    std::vector<private_bins> partial_le(workers), partial_he(workers), partial_joint(workers);
+    parallel_for_workers(0, rows, 64, [&](size_t worker, size_t begin, size_t end) {
+        size_t n = (end - begin) * extent.x;
+        partial_le[worker].prepare(bin_count);
+        partial_he[worker].prepare(bin_count);
+        partial_joint[worker].prepare(stats.joint.counts.size());
+        partial_le[worker].reserve(n);
+        partial_he[worker].reserve(n);
+        partial_joint[worker].reserve(n);
+        uint32_t* counts_le = partial_le[worker].counts.data();
+        uint32_t* counts_he = partial_he[worker].counts.data();
+        uint32_t* counts_joint = partial_joint[worker].counts.data();
+        for (size_t row = begin; row < end; ++row)
+        {
+            int y = roi.begin.y + static_cast<int>(row % extent.y);
+            int z = roi.begin.z + static_cast<int>(row / extent.y);
+            const uint16_t* in_le = &le(roi.begin.x, y, z);
+            const uint16_t* in_he = &he(roi.begin.x, y, z);
+            for (int x = 0; x < extent.x; ++x)
+            {
+                uint32_t a = in_le[x], b = in_he[x];
+                ++counts_le[a];
+                ++counts_he[b];
+                ++counts_joint[std::min((b * scale_y) >> 16, max_y) * stride + std::min((a * scale_x) >> 16, max_x)];
+            }
+        }
+    });
+    for (size_t i = 0; i < workers; ++i)
+    {
+        partial_le[i].merge_into(stats.le.counts);
+        partial_he[i].merge_into(stats.he.counts);
+        partial_joint[i].merge_into(stats.joint.counts);
+    }
+    finish(stats.le);
+    finish(stats.he);
+    return stats;
+}
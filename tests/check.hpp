@@ -0,0 +1,25 @@
+#pragma once
+#include <source_location>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+// 失败时输出位置和说明并计数, main 最后返回 check_exit_code()
+inline int check_failures = 0;
+
+static inline bool check(bool ok, std::string_view what, std::source_location location = std::source_location::current())
+{
+    if (not ok)
+    {
+        ++check_failures;
+        SPDLOG_ERROR("{}:{}: check failed: {}", location.file_name(), location.line(), what);
+    }
+    return ok;
+}
+
+static inline int check_exit_code()
+{
+    if (check_failures != 0)
+        SPDLOG_ERROR("{} check(s) failed", check_failures);
+    return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,75 @@
+#include <cstdint>
+#include <random>
+
+#include "check.hpp"
+#include "interface/bricked_voxel.hpp"
+#include "material_classify.hpp"
+#include "mpr.hpp"
+
+// 边长不是砖块大小的整数倍, 覆盖边缘砖块的填充部分
+static voxel<uint16_t> random_volume(glm::ivec3 size, uint32_t seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(0, 65535);
+    voxel<uint16_t> vol = make_voxel<uint16_t>(size);
+    for (auto& v : vol.memory)
+        v = static_cast<uint16_t>(dist(rng));
+    return vol;
+}
+
+static void round_trip(const voxel<uint16_t>& vol)
+{
+    auto bricked = make_bricked_voxel<uint16_t, 8>(vol);
+    bool same = true;
+    for (int z = 0; z < vol.size.z; ++z)
+        for (int y = 0; y < vol.size.y; ++y)
+            for (int x = 0; x < vol.size.x; ++x)
+                same = same && bricked(x, y, z) == vol(x, y, z);
+    check(same, "bricked_voxel element access matches the dense volume");
+    check(to_voxel(bricked).memory == vol.memory, "to_voxel(make_bricked_voxel(v)) == v");
+}
+
+static void classify(const voxel<uint16_t>& le, const voxel<uint16_t>& he)
+{
+    std::mt19937 rng(7);
+    auto table = make_pixel<uint8_t>({ 16, 16 });
+    for (auto& v : table.memory)
+        v = static_cast<uint8_t>(rng() % 8);
+    auto lut = make_material_lut(table, glm::uvec2(65535));
+
+    auto dense = classify_materials(as_view(le), as_view(he), lut);
+    auto bricked = classify_materials(make_bricked_voxel<uint16_t, 8>(le), make_bricked_voxel<uint16_t, 8>(he), lut);
+    bool same = bricked.size == dense.size;
+    for (int z = 0; same && z < dense.size.z; ++z)
+        for (int y = 0; y < dense.size.y; ++y)
+            for (int x = 0; x < dense.size.x; ++x)
+                same = same && bricked(x, y, z) == dense(x, y, z);
+    check(same, "bricked classify_materials matches the dense path");
+}
+
+static void slice(const voxel<uint16_t>& vol)
+{
+    auto bricked = make_bricked_voxel<uint16_t, 8>(vol);
+    glm::vec3 center = glm::vec3(vol.size) * 0.5f;
+    mpr_plane planes[3] = {
+        make_axis_plane(vol.size, 2, 0.4f),
+        make_oblique_plane(center, glm::vec3(1.0f, 2.0f, 3.0f), { 48, 40 }, 0.7f),
+        make_oblique_plane(center, glm::vec3(-2.0f, 1.0f, 0.5f), { 32, 32 }, 1.3f),
+    };
+    planes[2].thickness = 5.0f;
+    planes[2].mode = slab_mode::average;
+    auto dense = reslice<float>(vol, std::span<const mpr_plane>(planes));
+    auto blocked = reslice<float>(bricked, std::span<const mpr_plane>(planes));
+    for (size_t i = 0; i < dense.size(); ++i)
+        check(dense[i].memory == blocked[i].memory, "bricked reslice matches the dense path");
+}
+
+int main()
+{
+    auto le = random_volume({ 37, 29, 23 }, 1);
+    auto he = random_volume({ 37, 29, 23 }, 2);
+    round_trip(le);
+    classify(le, he);
+    slice(le);
+    return check_exit_code();
+}
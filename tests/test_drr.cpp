@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <utility>
+
+#include "check.hpp"
+#include "drr.hpp"
+
+constexpr float value = 5.0f;
+constexpr float infinity = std::numeric_limits<float>::infinity();
+
+// 射线与包围盒 [lo, hi) 的弦长, 用 double 计算作为参考
+static double chord_length(glm::dvec3 lo, glm::dvec3 hi, glm::dvec3 origin, glm::dvec3 direction)
+{
+    double t0 = -std::numeric_limits<double>::infinity(), t1 = std::numeric_limits<double>::infinity();
+    for (int k = 0; k < 3; ++k)
+    {
+        if (direction[k] == 0.0)
+        {
+            if (origin[k] < lo[k] || origin[k] >= hi[k])
+                return 0.0;
+            continue;
+        }
+        double a = (lo[k] - origin[k]) / direction[k];
+        double b = (hi[k] - origin[k]) / direction[k];
+        t0 = std::max(t0, std::min(a, b));
+        t1 = std::min(t1, std::max(a, b));
+    }
+    return std::max(0.0, t1 - t0);
+}
+
+static bool approx(double a, double b)
+{
+    return std::abs(a - b) <= 1e-4 * std::max(1.0, std::abs(b));
+}
+
+int main()
+{
+    // 各向异性体素间距, 检查长度按世界坐标累加
+    auto vol = make_voxel<float>({ 20, 12, 8 });
+    std::fill(vol.memory.begin(), vol.memory.end(), value);
+    drr_geometry geo;
+    geo.voxel_spacing = { 1.0f, 2.0f, 0.5f };
+    geo.volume_origin = { -3.0f, 1.0f, 2.0f };
+    glm::vec3 extent = glm::vec3(vol.size) * geo.voxel_spacing;
+    glm::vec3 lo = geo.volume_origin, hi = geo.volume_origin + extent;
+    glm::vec3 center = (lo + hi) * 0.5f;
+    auto integral = [&](glm::vec3 origin, glm::vec3 direction, float t_min = -infinity, float t_max = infinity) {
+        return drr_detail::line_integral(as_view(std::as_const(vol)), geo, origin, direction, t_min, t_max);
+    };
+
+    // 沿坐标轴: 弦长等于该轴的范围
+    glm::vec3 inside = lo + extent * glm::vec3(0.31f, 0.47f, 0.73f);
+    for (int k = 0; k < 3; ++k)
+    {
+        glm::vec3 direction(0.0f);
+        direction[k] = 1.0f;
+        glm::vec3 origin = inside;
+        origin[k] = lo[k] - 10.0f;
+        check(approx(integral(origin, direction), value * extent[k]), "axis-aligned ray integrates value * extent");
+        check(approx(integral(origin + direction * (20.0f + extent[k]), -direction), value * extent[k]), "reversed axis-aligned ray integrates value * extent");
+        // 只统计 [t_min, t_max] 内的部分
+        check(approx(integral(origin, direction, 10.0f + extent[k] * 0.25f, 10.0f + extent[k] * 0.75f), value * extent[k] * 0.5), "t range clips the integral");
+    }
+
+    // 沿包围盒对角线: 弦长等于对角线长度
+    check(approx(integral(center - glm::normalize(extent) * 100.0f, glm::normalize(extent)), value * glm::length(extent)), "diagonal ray integrates value * diagonal");
+    glm::vec3 face_diagonal = glm::normalize(glm::vec3(extent.x, extent.y, 0.0f));
+    check(approx(integral(center - face_diagonal * 100.0f, face_diagonal), value * glm::length(glm::vec2(extent))), "face diagonal ray integrates value * diagonal");
+
+    // 随机方向: 与解析弦长比较, 包括擦过和错过包围盒的射线
+    std::mt19937 rng(17);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    bool same = true;
+    for (int i = 0; i < 2000; ++i)
+    {
+        glm::vec3 direction = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)));
+        glm::vec3 through = center + glm::vec3(unit(rng), unit(rng), unit(rng)) * extent * 0.7f;
+        glm::vec3 origin = through - direction * 100.0f;
+        double expected = value * chord_length(glm::dvec3(lo), glm::dvec3(hi), glm::dvec3(origin), glm::dvec3(direction));
+        same = same && std::abs(integral(origin, direction) - expected) <= 1e-3 * std::max(1.0, expected);
+    }
+    check(same, "random rays integrate value * chord length");
+    check(integral(hi + 1.0f, glm::vec3(1.0f, 0.0f, 0.0f)) == 0.0, "ray outside the volume integrates to zero");
+
+    // 平行束沿 z 穿过整个体数据, 每个像素都是 value * 深度
+    geo.parallel_beam = true;
+    geo.direction = { 0.0f, 0.0f, 1.0f };
+    geo.detector_size = { 8, 6 };
+    geo.detector_origin = glm::vec3(lo.x + 0.5f, lo.y + 0.5f, lo.z - 5.0f);
+    geo.detector_u = { extent.x / 8.0f, 0.0f, 0.0f };
+    geo.detector_v = { 0.0f, extent.y / 6.0f, 0.0f };
+    auto image = render_drr(vol, geo);
+    same = true;
+    for (float v : image.memory)
+        same = same && approx(v, value * extent.z);
+    check(same, "parallel beam DRR of a constant box is value * depth");
+    return check_exit_code();
+}
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+#include "camera_info.hpp"
+#include "check.hpp"
+#include "cpu_ray_marcher.hpp"
+#include "interface/layout.hpp"
+#include "interface/pixel.hpp"
+#include "interface/voxel.hpp"
+
+static voxel<uint16_t> random_volume(glm::ivec3 size)
+{
+    std::mt19937 rng(3);
+    voxel<uint16_t> vol = make_voxel<uint16_t>(size);
+    for (auto& v : vol.memory)
+        v = static_cast<uint16_t>(rng() % 4096);
+    return vol;
+}
+
+template <typename Layout> static void round_trip(const voxel<uint16_t>& vol, const char* name)
+{
+    auto converted = relayout<Layout>(vol);
+    bool same = true;
+    for (int z = 0; z < vol.size.z; ++z)
+        for (int y = 0; y < vol.size.y; ++y)
+            for (int x = 0; x < vol.size.x; ++x)
+                same = same && converted(x, y, z) == vol(x, y, z);
+    check(same, fmt::format("{}: element access matches layout_right", name));
+    check(relayout<std::layout_right>(converted).memory == vol.memory, fmt::format("{}: right -> {} -> right is lossless", name, name));
+
+    auto image = make_pixel<uint16_t>({ vol.size.x, vol.size.y });
+    std::copy_n(vol.memory.begin(), image.memory.size(), image.memory.begin());
+    check(relayout<std::layout_right>(relayout<Layout>(image)).memory == image.memory, fmt::format("{}: 2d round trip is lossless", name));
+}
+
+// 三线性插值的角点经布局策略读取, 值相同则图像逐像素相同
+template <typename Layout> static void ray_march(const voxel<uint16_t>& vol, const char* name)
+{
+    auto converted = relayout<Layout>(vol);
+    camera_info cam;
+    cam.position = glm::vec3(0.4f, 0.3f, 2.5f);
+    for (auto filter : { sample_filter::nearest, sample_filter::trilinear })
+        for (auto composite : { composite_mode::mean, composite_mode::alpha })
+        {
+            cpu_ray_march_options<uint16_t> options;
+            options.filter = filter;
+            options.composite = composite;
+            auto expected = make_pixel<uint32_t>({ 64, 48 });
+            auto actual = make_pixel<uint32_t>({ 64, 48 });
+            cpu_ray_march(cam, vol, expected, options);
+            cpu_ray_march(cam, converted, actual, options);
+            check(expected.memory == actual.memory, fmt::format("{}: cpu_ray_march matches layout_right", name));
+        }
+}
+
+int main()
+{
+    // 各轴都不是 2 的幂, 也不是块大小的整数倍
+    auto vol = random_volume({ 37, 20, 9 });
+    round_trip<layout_morton>(vol, "morton");
+    round_trip<layout_tiled<8, 8, 8>>(vol, "tiled");
+    ray_march<layout_morton>(vol, "morton");
+    ray_march<layout_tiled<8, 8, 8>>(vol, "tiled");
+
+    // 补齐后的跨度超过 int 时不能溢出 (1024 x 1024 x 1025 补齐为 2048^3)
+    check(voxel<uint8_t, layout_morton>::required_size({ 1024, 1024, 1025 }) == size_t(2048) * 2048 * 2048, "morton span of 1024x1024x1025 is 2048^3");
+    return check_exit_code();
+}
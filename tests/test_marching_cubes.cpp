@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <numbers>
+#include <set>
+#include <tuple>
+#include <utility>
+
+#include "check.hpp"
+#include "marching_cubes.hpp"
+
+// 表在编译期生成并由 static_assert 检查, 这里再确认运行时看到的是同一份
+static_assert(marching_cubes_detail::validate_case_table(marching_cubes_detail::case_table_data));
+
+// 球心不在格点上, radius 以体素为单位, 内部为正
+static voxel<float> sphere(glm::ivec3 size, glm::vec3 center, float radius)
+{
+    voxel<float> vol = make_voxel<float>(size);
+    for (int z = 0; z < size.z; ++z)
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+                vol(x, y, z) = radius - glm::length(glm::vec3(x, y, z) - center);
+    return vol;
+}
+
+static void check_closed_sphere(const isosurface_mesh& mesh, glm::ivec3 size, float radius)
+{
+    check(not mesh.indices.empty() && mesh.indices.size() % 3 == 0, "mesh has whole triangles");
+
+    // 每条有向边恰好出现一次, 且反向边也恰好出现一次: 封闭且绕序一致
+    std::map<std::pair<uint32_t, uint32_t>, int> directed;
+    bool degenerate = false;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32_t a = mesh.indices[i + k], b = mesh.indices[i + (k + 1) % 3];
+            degenerate |= a == b || a >= mesh.vertices.size();
+            ++directed[{ a, b }];
+        }
+    check(not degenerate, "no degenerate triangles or out of range indices");
+    bool closed = true, consistent = true;
+    for (const auto& [edge, count] : directed)
+    {
+        auto reverse = directed.find({ edge.second, edge.first });
+        closed = closed && reverse != directed.end();
+        consistent = consistent && count == 1 && (reverse == directed.end() || reverse->second == 1);
+    }
+    check(closed, "every edge is shared by two triangles");
+    check(consistent, "shared edges run in opposite directions");
+
+    // 亏格为 0 的封闭曲面: V - E + F = 2
+    auto faces = static_cast<long long>(mesh.indices.size() / 3);
+    auto edges = static_cast<long long>(directed.size() / 2);
+    auto vertices = static_cast<long long>(mesh.vertices.size());
+    check(vertices - edges + faces == 2, "euler characteristic of a sphere");
+
+    // 每条格点棱只有一个顶点
+    std::set<std::tuple<float, float, float>> positions;
+    for (const auto& v : mesh.vertices)
+        positions.insert({ v.position.x, v.position.y, v.position.z });
+    check(positions.size() == mesh.vertices.size(), "no duplicated vertices");
+
+    // 三角形逆时针为正面且朝外: 有向体积为正, 且接近球的体积 (代理立方体空间中每个轴缩放 1 / size)
+    double volume = 0.0;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        auto p = [&](size_t k) { return glm::dvec3(mesh.vertices[mesh.indices[i + k]].position); };
+        volume += glm::dot(p(0), glm::cross(p(1), p(2))) / 6.0;
+    }
+    double expected = 4.0 / 3.0 * std::numbers::pi * radius * radius * radius / (static_cast<double>(size.x) * size.y * size.z);
+    check(volume > 0.0, "triangles face outward");
+    check(std::abs(volume - expected) <= 0.03 * expected, "enclosed volume matches the sphere");
+}
+
+int main()
+{
+    glm::ivec3 size = { 26, 24, 22 };
+    float radius = 8.3f;
+    auto vol = sphere(size, glm::vec3(12.4f, 11.7f, 10.2f), radius);
+    // 单段和多段 (段间共享顶点在合并时解析) 都应得到同样封闭的网格
+    for (int slab_depth : { 64, 3, 1 })
+        check_closed_sphere(extract_isosurface(vol, 0.0f, slab_depth), size, radius);
+    return check_exit_code();
+}
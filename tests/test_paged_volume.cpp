@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <filesystem>
+#include <random>
+
+#include "check.hpp"
+#include "paged_volume.hpp"
+#include "volume_file.hpp"
+
+constexpr int brick_size = 16;
+constexpr size_t cache_bricks = 4;
+
+// 砖块内容与 read_all 得到的稠密体数据逐体素比较
+static bool same_as(const paged_volume<uint16_t>::brick_handle& brick, const voxel<uint16_t>& dense)
+{
+    if (not brick)
+        return false;
+    for (int z = 0; z < brick.extent.z; ++z)
+        for (int y = 0; y < brick.extent.y; ++y)
+            for (int x = 0; x < brick.extent.x; ++x)
+                if (brick(x, y, z) != dense(brick.origin.x + x, brick.origin.y + y, brick.origin.z + z))
+                    return false;
+    return true;
+}
+
+static void run(const std::filesystem::path& file, const voxel<uint16_t>& vol)
+{
+    auto reader_ret = volume_file_reader::open(file);
+    auto paged_ret = paged_volume<uint16_t>::open(file, cache_bricks * brick_size * brick_size * brick_size * sizeof(uint16_t));
+    if (not check(reader_ret.has_value() && paged_ret.has_value(), "open volume file"))
+        return;
+    auto dense_ret = reader_ret.value()->read_all<uint16_t>();
+    if (not check(dense_ret.has_value(), "read_all"))
+        return;
+    const auto& dense = dense_ret.value();
+    auto& paged = *paged_ret.value();
+    // 关闭自动预取, 命中与未命中次数只由下面的访问决定
+    paged.prefetch_depth = 0;
+    size_t count = paged.header().brick_count();
+    check(dense.memory == vol.memory, "read_all matches the written volume");
+    check(paged.statistics().capacity_bricks == cache_bricks, "cache capacity is derived from the byte budget");
+
+    // 顺序读一遍: 每个砖块都未命中, 超出容量的部分逐个淘汰
+    bool same = true;
+    for (size_t i = 0; i < count; ++i)
+        same = same_as(paged.pin(i), dense) && same;
+    check(same, "bricks read through the cache match read_all");
+    auto stats = paged.statistics();
+    check(stats.misses == count && stats.hits == 0, "first pass misses every brick");
+    check(stats.evictions == count - cache_bricks, "first pass evicts all but the cache capacity");
+    check(stats.resident_bricks == cache_bricks, "cache stays at capacity");
+
+    // 最近访问的砖块仍在缓存中
+    paged.reset_statistics();
+    for (size_t i = count - cache_bricks; i < count; ++i)
+        same_as(paged.pin(i), dense);
+    stats = paged.statistics();
+    check(stats.hits == cache_bricks && stats.misses == 0, "recently used bricks hit");
+
+    // 固定的砖块在其余砖块全部经过缓存后仍然驻留
+    auto pinned = paged.pin(0);
+    for (size_t i = 1; i < count; ++i)
+        same_as(paged.pin(i), dense);
+    check(same_as(pinned, dense), "pinned brick keeps its data");
+    check(paged.statistics().resident_bricks == cache_bricks, "cache stays at capacity while a brick is pinned");
+    paged.reset_statistics();
+    same_as(paged.pin(0), dense);
+    check(paged.statistics().hits == 1, "pinned brick is never evicted");
+
+    // 随机访问单个体素
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<int> px(0, vol.size.x - 1), py(0, vol.size.y - 1), pz(0, vol.size.z - 1);
+    same = true;
+    for (int i = 0; i < 1000; ++i)
+    {
+        int x = px(rng), y = py(rng), z = pz(rng);
+        same = same && paged.at(x, y, z) == vol(x, y, z);
+    }
+    check(same, "paged_volume::at matches the dense volume");
+}
+
+int main()
+{
+    // 边长不是砖块大小的整数倍, 缓存只能容纳其中 4 个砖块
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> dist(0, 65535);
+    auto vol = make_voxel<uint16_t>({ 70, 50, 40 });
+    for (auto& v : vol.memory)
+        v = static_cast<uint16_t>(dist(rng));
+
+    auto file = std::filesystem::temp_directory_path() / "test_paged_volume.mvv";
+    if (check(write_volume_file<uint16_t>(file, as_view(vol), brick_size).has_value(), "write_volume_file"))
+        run(file, vol);
+    std::filesystem::remove(file);
+    return check_exit_code();
+}
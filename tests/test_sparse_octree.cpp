@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "check.hpp"
+#include "sparse_octree.hpp"
+
+constexpr int leaf = 8;
+constexpr uint16_t threshold = 1000;
+
+// 低于阈值的噪声铺满整个体, 几个球内为高值; 只含噪声的砖块不存储, 查询时应返回背景
+static voxel<uint16_t> make_volume(glm::ivec3 size)
+{
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> noise(0, threshold - 1), high(threshold, 65535);
+    voxel<uint16_t> vol = make_voxel<uint16_t>(size);
+    for (auto& v : vol.memory)
+        v = static_cast<uint16_t>(noise(rng));
+    const glm::vec4 spheres[] = { { 8.0f, 9.0f, 6.0f, 5.0f }, { 38.0f, 30.0f, 22.0f, 4.0f }, { 30.0f, 8.0f, 20.0f, 3.0f } };
+    for (int z = 0; z < size.z; ++z)
+        for (int y = 0; y < size.y; ++y)
+            for (int x = 0; x < size.x; ++x)
+                for (auto s : spheres)
+                    if (glm::length(glm::vec3(x, y, z) - glm::vec3(s)) <= s.w)
+                        vol(x, y, z) = static_cast<uint16_t>(high(rng));
+    return vol;
+}
+
+// 逐砖块暴力判断是否保留
+static std::vector<uint8_t> kept_bricks(const voxel<uint16_t>& vol, glm::ivec3 grid)
+{
+    std::vector<uint8_t> kept(static_cast<size_t>(grid.x) * grid.y * grid.z, 0);
+    for (int z = 0; z < vol.size.z; ++z)
+        for (int y = 0; y < vol.size.y; ++y)
+            for (int x = 0; x < vol.size.x; ++x)
+                if (vol(x, y, z) >= threshold)
+                    kept[(static_cast<size_t>(z / leaf) * grid.y + y / leaf) * grid.x + x / leaf] = 1;
+    return kept;
+}
+
+int main()
+{
+    glm::ivec3 size = { 45, 37, 29 };
+    glm::ivec3 grid = (size + glm::ivec3(leaf - 1)) / leaf;
+    auto vol = make_volume(size);
+    auto kept = kept_bricks(vol, grid);
+    auto kept_at = [&](glm::ivec3 brick) { return kept[(static_cast<size_t>(brick.z) * grid.y + brick.y) * grid.x + brick.x] != 0; };
+    auto expected = [&](int x, int y, int z) -> float { return kept_at(glm::ivec3(x, y, z) / leaf) ? vol(x, y, z) : 0.0f; };
+
+    auto tree = build_sparse_octree<uint16_t, leaf>(as_view(vol), threshold);
+    size_t kept_count = 0;
+    for (auto k : kept)
+        kept_count += k;
+    check(tree.leaf_count() == kept_count, "leaf count matches the bricks holding values above the threshold");
+
+    // 随机点上的 at 和 sample 与稠密体数据比较
+    std::mt19937 rng(13);
+    std::uniform_real_distribution<float> ux(-2.0f, size.x + 1.0f), uy(-2.0f, size.y + 1.0f), uz(-2.0f, size.z + 1.0f);
+    bool at_same = true, sample_same = true;
+    for (int i = 0; i < 20000; ++i)
+    {
+        glm::vec3 p = { ux(rng), uy(rng), uz(rng) };
+        glm::ivec3 v = glm::clamp(glm::ivec3(glm::floor(p)), glm::ivec3(0), size - 1);
+        at_same = at_same && tree.at(v.x, v.y, v.z) == expected(v.x, v.y, v.z);
+
+        glm::vec3 c = glm::clamp(p, glm::vec3(0.0f), glm::vec3(size - 1));
+        glm::ivec3 p0 = glm::ivec3(glm::floor(c));
+        glm::ivec3 p1 = glm::min(p0 + 1, size - 1);
+        glm::vec3 f = c - glm::vec3(p0);
+        float reference = 0.0f;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            glm::ivec3 o = { corner & 1, (corner >> 1) & 1, corner >> 2 };
+            glm::vec3 w = glm::mix(1.0f - f, f, glm::vec3(o));
+            glm::ivec3 q = { o.x ? p1.x : p0.x, o.y ? p1.y : p0.y, o.z ? p1.z : p0.z };
+            reference += w.x * w.y * w.z * expected(q.x, q.y, q.z);
+        }
+        sample_same = sample_same && std::abs(tree.sample(p) - reference) <= 0.05f;
+    }
+    check(at_same, "sparse_octree::at matches the dense volume");
+    check(sample_same, "sparse_octree::sample matches trilinear interpolation of the dense volume");
+    check(tree.at(-1, 0, 0) == 0 && tree.at(size.x, 0, 0) == 0, "out of range queries return the background");
+
+    // traverse 与暴力求交比较: 对每个保留的砖块做 slab 测试, 集合相同且按进入距离排序
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    glm::vec3 center = glm::vec3(size) * 0.5f;
+    std::vector<glm::ivec3> directions = { { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 1, 1, 1 }, { -1, 1, 0 } };
+    bool hits_same = true, ordered = true, leaves_match = true;
+    for (int i = 0; i < 500; ++i)
+    {
+        glm::vec3 direction = i < static_cast<int>(directions.size()) ? glm::vec3(directions[i]) : glm::vec3(unit(rng), unit(rng), unit(rng));
+        direction = glm::normalize(direction);
+        glm::vec3 target = center + glm::vec3(unit(rng), unit(rng), unit(rng)) * center;
+        glm::vec3 origin = target - direction * 100.0f;
+
+        std::vector<glm::ivec3> traversed;
+        float last_enter = -1.0f;
+        tree.traverse(origin, direction, 0.0f, 1e30f, [&](size_t index, glm::ivec3 leaf_origin, float t_enter, float) {
+            traversed.push_back(leaf_origin);
+            ordered = ordered && t_enter >= last_enter - 1e-3f;
+            last_enter = t_enter;
+            leaves_match = leaves_match && tree.leaves[index * tree.leaf_volume] == vol(leaf_origin.x, leaf_origin.y, leaf_origin.z);
+            return true;
+        });
+
+        glm::vec3 inv_direction;
+        for (int a = 0; a < 3; ++a)
+            inv_direction[a] = 1.0f / (std::abs(direction[a]) < 1e-8f ? (direction[a] < 0.0f ? -1e-8f : 1e-8f) : direction[a]);
+        std::vector<glm::ivec3> brute;
+        for (int z = 0; z < grid.z; ++z)
+            for (int y = 0; y < grid.y; ++y)
+                for (int x = 0; x < grid.x; ++x)
+                {
+                    glm::ivec3 brick = { x, y, z };
+                    if (not kept_at(brick))
+                        continue;
+                    glm::vec3 a = (glm::vec3(brick * leaf) - origin) * inv_direction;
+                    glm::vec3 b = (glm::min(glm::vec3(brick * leaf + leaf), glm::vec3(size)) - origin) * inv_direction;
+                    glm::vec3 enter = glm::min(a, b), exit = glm::max(a, b);
+                    float t0 = std::max(std::max(enter.x, enter.y), std::max(enter.z, 0.0f));
+                    float t1 = std::min(std::min(exit.x, exit.y), exit.z);
+                    if (t0 <= t1)
+                        brute.push_back(brick * leaf);
+                }
+        auto less = [](glm::ivec3 a, glm::ivec3 b) { return std::tie(a.z, a.y, a.x) < std::tie(b.z, b.y, b.x); };
+        std::sort(traversed.begin(), traversed.end(), less);
+        hits_same = hits_same && traversed == brute;
+    }
+    check(hits_same, "traverse visits the same leaves as a brute-force intersection");
+    check(ordered, "traverse visits leaves front to back");
+    check(leaves_match, "traverse reports the leaf index of its origin");
+    return check_exit_code();
+}